@@ -0,0 +1,196 @@
+/// ============================
+/// @author Andrei Biu - Pislaru
+/// @brief Implementation of Batch "static" class
+/// ============================
+
+#ifndef BATCH_HPP
+#define BATCH_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__unix__)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "Bytecode.hpp"
+#include "Environment.hpp"
+#include "Input.hpp"
+#include "Memory.hpp"
+#include "Output.hpp"
+#include "Parser.hpp"
+#include "Program.hpp"
+
+/**
+ * @class Batch
+ * @brief Runs a list of jobs (programs with their input, output and base) on
+ *        a pool of worker threads inside the interpreter process
+ * @details The list has a job per line: the program path, the input path,
+ *          the output path and optionally the base (the one given to the
+ *          interpreter otherwise). Each worker takes the next job of the list
+ *          and runs it contained in its thread, with its own memory, input
+ *          and output; when all are done, a line is printed for each job (in
+ *          order) with its program, its exit status (as the status of an
+ *          interpreter process running it) and its error message, if any.
+ *          There are as many workers as hardware threads, unless given by
+ *          the GLYPHO_BATCH_WORKERS environment variable
+ */
+class Batch
+{
+    /// @defgroup Nested Types
+    private:
+        struct Job
+        {
+            std::string program;
+            std::string input;
+            std::string output;
+            byte base;
+            int status;
+            std::string message;
+        };
+
+    /// @defgroup Private Static Methods
+    private:
+        static std::vector<Job> Read(const char* path, byte base);
+        static xword Workers(xword jobCount);
+        static void Run(Job& job);
+
+    /// @defgroup Public Static Methods
+    public:
+        static void Run();
+};
+
+
+/// @ingroup Private Static Methods
+/// @{
+
+// Reads the list of jobs (the lines without a job being skipped)
+std::vector<Batch::Job> Batch::Read(const char* path, byte base)
+{
+    std::ifstream stream(path);
+    std::vector<Job> jobs;
+    std::string line;
+
+    if (!stream)
+    {
+        std::cerr << "Invalid batch." << std::endl;
+        exit(-100);
+    }
+
+    while (std::getline(stream, line))
+    {
+        std::istringstream fields(line);
+        Job job { std::string(), std::string(), std::string(), base, 0, std::string() };
+        int jobBase = base;
+
+        if (!(fields >> job.program))
+            continue;
+        if (!(fields >> job.input >> job.output) || (!(fields >> jobBase) && !fields.eof()) ||
+            jobBase < 2 || jobBase > 37)
+        {
+            std::cerr << "Invalid batch." << std::endl;
+            exit(-100);
+        }
+        job.base = jobBase;
+        jobs.push_back(std::move(job));
+    }
+
+    return jobs;
+}
+
+INLINE xword Batch::Workers(xword jobCount)
+{
+    xword workers = std::thread::hardware_concurrency();
+
+    if (const char* value = getenv("GLYPHO_BATCH_WORKERS"))
+        workers = std::strtoull(value, nullptr, 10);
+    return std::max<xword>(1, std::min(workers, jobCount));
+}
+
+// Runs a job contained in the calling thread, recording how it has exited
+void Batch::Run(Job& job)
+{
+#if defined(__unix__)
+    int input = open(job.input.c_str(), O_RDONLY);
+    FILE* output = fopen(job.output.c_str(), "wb");
+
+    if (input < 0 || !output)
+    {
+        job.status = -100;
+        job.message = "Invalid job.";
+    }
+    else
+    {
+        Environment::Contain(job.program.c_str(), job.base);
+        Input::Open(input);
+        Output::Open(output);
+        try
+        {
+            (Environment::Cache() ? Bytecode::Load() : Program(Parser::Parse())).Run();
+            Environment::ExitNormal();
+        }
+        catch (const Environment::Exit& exit)
+        {
+            job.status = exit.status;
+            job.message = exit.Message();
+        }
+        Memory::Clear();
+        Input::Open(STDIN_FILENO);
+        Output::Open(nullptr);
+    }
+
+    if (input >= 0)
+        close(input);
+    if (output)
+        fclose(output);
+#else
+    job.status = -100;
+    job.message = "Invalid job.";
+#endif
+}
+
+/// @}
+
+/// @ingroup Public Static Methods
+/// @{
+
+/**
+ * @brief Runs the jobs listed in the file given to the interpreter and
+ *      prints their exit statuses
+ */
+void Batch::Run()
+{
+    std::vector<Job> jobs = Read(Environment::ProgramFilename(), Environment::Base());
+    std::vector<std::thread> workers;
+    std::atomic<xword> next(0);
+
+    for (xword count = Workers(jobs.size()); workers.size() < count; )
+        workers.emplace_back([&] {
+            for (xword index; (index = next++) < jobs.size(); )
+                Run(jobs[index]);
+        });
+    for (std::thread& worker : workers)
+        worker.join();
+
+    for (const Job& job : jobs)
+    {
+        std::cout << job.program << ' ' << (job.status & 0xFF);
+        if (!job.message.empty())
+            std::cout << ' ' << job.message;
+        std::cout << '\n';
+    }
+    std::cout.flush();
+}
+
+/// @}
+
+#endif  // BATCH_HPP
@@ -0,0 +1,330 @@
+/// ============================
+/// @author Andrei Biu - Pislaru
+/// @brief Implementation of Bytecode "static" class
+/// ============================
+
+#ifndef BYTECODE_HPP
+#define BYTECODE_HPP
+
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__unix__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "Parser.hpp"
+#include "Program.hpp"
+
+/**
+ * @class Bytecode
+ * @brief Caches the compiled programs in binary files next to their sources
+ *        (the source path followed by .glc), so that later runs map them
+ *        instead of parsing and compiling the sources again
+ * @details A file starts with a header keyed on the source (its size,
+ *          modification time and checksum), followed by the arrays of the
+ *          compiled program (opcodes, jump offsets, operands and origins)
+ *          in the native layout, each aligned to a word, whose checksum is
+ *          kept in the header too (a damaged cache is rebuilt); the loops run in
+ *          closed form are analyzed again and the instructions are only
+ *          rebuilt (both from the unoptimized code) if the reference mode
+ *          needs them. A cache is used when the size and the
+ *          modification time of the source match, or else when the checksum
+ *          does; otherwise the source is parsed and the cache rewritten (the
+ *          failures to write it are ignored)
+ */
+class Bytecode
+{
+    /// @defgroup Friends
+    friend class Server;
+
+    /// @defgroup Nested Types
+    private:
+        struct Header
+        {
+            char magic[8];
+            xword version;
+            xword sourceSize;
+            xword sourceTime;
+            xword checksum;
+            xword payloadChecksum;
+            xword instructionCount;
+            xword opcodeCount;
+            xword baseline;
+        };
+
+    /// @defgroup Static Fields
+    private:
+        static constexpr char magic[8] = { 'G', 'L', 'Y', 'P', 'H', 'O', 'B', 'C' };
+        static constexpr xword version = 4;
+        static constexpr byte opcodeLimit = Opcode::PopUnchecked + 1;
+
+    /// @defgroup Private Static Methods
+    private:
+        INLINE static xword Align(xword length);
+        INLINE static xword Length(xword opcodeCount);
+        INLINE static xword Capacity(xword length);
+        INLINE static std::string Path();
+        static xword Checksum(const char* source, xword size);
+        static bool Valid(const Program& program);
+        static bool Read(Program& program, xword size, xword time, const xword* checksum);
+        static void Write(const Program& program, xword size, xword time, xword checksum);
+
+    /// @defgroup Public Static Methods
+    public:
+        static Program Load();
+};
+
+
+/// @ingroup Private Static Methods
+/// @{
+
+INLINE xword Bytecode::Align(xword length)
+{
+    return (length + sizeof(xword) - 1) & ~(sizeof(xword) - 1);
+}
+
+// Returns the length of a file for a compiled program with opcodeCount opcodes
+// (bounded by Capacity, so that it does not overflow)
+INLINE xword Bytecode::Length(xword opcodeCount)
+{
+    return sizeof(Header) + Align(opcodeCount) + opcodeCount * (2 * sizeof(long) + sizeof(xword));
+}
+
+// Returns the most opcodes that a file of the given length can hold
+INLINE xword Bytecode::Capacity(xword length)
+{
+    return length < sizeof(Header) ? 0 : (length - sizeof(Header)) / (1 + 2 * sizeof(long) + sizeof(xword));
+}
+
+INLINE std::string Bytecode::Path()
+{
+    return std::string(Environment::ProgramFilename()) + ".glc";
+}
+
+// A word by word multiplicative hash of the source (not cryptographic)
+xword Bytecode::Checksum(const char* source, xword size)
+{
+    xword hash = size ^ 0x9E3779B97F4A7C15, word, index = 0;
+
+    for (; index + sizeof(xword) <= size; index += sizeof(xword))
+    {
+        memcpy(&word, source + index, sizeof(xword));
+        hash = (hash ^ word) * 0xFF51AFD7ED558CCD;
+        hash ^= hash >> 32;
+    }
+    for (; index < size; ++index)
+    {
+        hash = (hash ^ (byte) source[index]) * 0xC4CEB9FE1A85EC53;
+        hash ^= hash >> 32;
+    }
+
+    return hash;
+}
+
+/**
+ * @brief Checks that a loaded program is one the compiler could have built:
+ *      known opcodes, each code ended by (and only by) an End opcode, the
+ *      unoptimized code holding one instruction per origin, the braces
+ *      jumping inside their code (past their loop, for the unoptimized left
+ *      braces, which delimit the loops run in closed form) and the opcodes
+ *      without memory checks only where the memory bounds allow them
+ * @details A damaged cache would otherwise run out of its arrays (or of the
+ *      memory), since the threaded dispatch trusts the compiled code
+ */
+bool Bytecode::Valid(const Program& program)
+{
+    const std::vector<byte>& opcodes = program.opcodes;
+    xword baseline = program.baseline, count = opcodes.size(), instructionCount = count - baseline - 1;
+
+    for (xword position = 0; position < count; ++position)
+    {
+        bool optimized = position < baseline;
+        xword begin = optimized ? 0 : baseline, end = optimized ? baseline : count;
+        xword origin = program.origins[position];
+        long target = (long) position + program.offsets[position];
+
+        if (opcodes[position] >= opcodeLimit || (opcodes[position] == Opcode::End) != (position + 1 == end))
+            return false;
+        if (optimized ? origin > instructionCount : origin != position - baseline)
+            return false;
+        if (!optimized && opcodes[position] > Opcode::End)
+            return false;
+
+        switch (opcodes[position])
+        {
+            case Opcode::Lbrace:
+                if (!optimized && target <= (long) position + 1)
+                    return false;
+                [[fallthrough]];
+            case Opcode::LbraceUnchecked:
+            case Opcode::Rbrace:
+                if (target < (long) begin || target >= (long) end)
+                    return false;
+                break;
+            default:
+                break;
+        }
+    }
+
+    std::vector<byte> code(opcodes.begin() + baseline, opcodes.end());
+    std::vector<xword> depths = Program::Depths(code, [&] (xword index) { return program.offsets[baseline + index]; });
+
+    for (xword position = 0; position < baseline; ++position)
+        if (opcodes[position] >= Opcode::RotUnchecked &&
+            opcodes[position] != Program::Verified(code, depths, program.origins[position]))
+            return false;
+
+    return true;
+}
+
+/**
+ * @brief Loads the compiled program from the cache if this matches the
+ *      source (by modification time or, if given, by checksum); returns
+ *      whether it has been loaded
+ */
+bool Bytecode::Read(Program& program, xword size, xword time, const xword* checksum)
+{
+#if defined(__unix__)
+    int file = open(Path().c_str(), O_RDONLY);
+    struct stat status;
+    bool loaded = false;
+
+    if (file < 0)
+        return false;
+    if (fstat(file, &status) || (xword) status.st_size < sizeof(Header))
+    {
+        close(file);
+        return false;
+    }
+
+    const char* data = (const char*) mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+    close(file);
+    if (data == MAP_FAILED)
+        return false;
+
+    Header header;
+    memcpy(&header, data, sizeof(Header));
+    if (!memcmp(header.magic, magic, sizeof(magic)) && header.version == version &&
+        header.sourceSize == size && (checksum ? header.checksum == *checksum : header.sourceTime == time) &&
+        header.opcodeCount <= Capacity(status.st_size) && header.baseline < header.opcodeCount &&
+        header.instructionCount == header.opcodeCount - header.baseline - 1 &&
+        Length(header.opcodeCount) == (xword) status.st_size &&
+        Checksum(data + sizeof(Header), status.st_size - sizeof(Header)) == header.payloadChecksum)
+    {
+        xword count = header.opcodeCount;
+        const char* opcodes = data + sizeof(Header);
+        const long* offsets = (const long*) (opcodes + Align(count));
+        const long* operands = offsets + count;
+        const xword* origins = (const xword*) (operands + count);
+
+        program.opcodes.assign(opcodes, opcodes + count);
+        program.offsets.assign(offsets, offsets + count);
+        program.operands.assign(operands, operands + count);
+        program.origins.assign(origins, origins + count);
+        program.baseline = header.baseline;
+        loaded = Valid(program) && program.AnalyzeLoops();
+    }
+
+    munmap((void*) data, status.st_size);
+    return loaded;
+#else
+    return false;
+#endif
+}
+
+// Writes the cache of a compiled program (through a temporary file unique to
+// the process and thread, so that concurrent runs never read a partial cache)
+void Bytecode::Write(const Program& program, xword size, xword time, xword checksum)
+{
+#if defined(__unix__)
+    Header header;
+    xword count = program.opcodes.size();
+    std::string path = Path(), temporary = path + "." + std::to_string(getpid()) + "." +
+                                           std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+    std::string payload;
+
+    payload.reserve(Length(count) - sizeof(Header));
+    payload.append((const char*) program.opcodes.data(), count);
+    payload.append(Align(count) - count, '\0');
+    payload.append((const char*) program.offsets.data(), count * sizeof(long));
+    payload.append((const char*) program.operands.data(), count * sizeof(long));
+    payload.append((const char*) program.origins.data(), count * sizeof(xword));
+
+    memcpy(header.magic, magic, sizeof(magic));
+    header.version = version;
+    header.sourceSize = size;
+    header.sourceTime = time;
+    header.checksum = checksum;
+    header.payloadChecksum = Checksum(payload.data(), payload.size());
+    header.instructionCount = count - program.baseline - 1;
+    header.opcodeCount = count;
+    header.baseline = program.baseline;
+
+    FILE* file = fopen(temporary.c_str(), "wb");
+    if (!file)
+        return;
+
+    bool written = fwrite(&header, sizeof(Header), 1, file) == 1 &&
+                   fwrite(payload.data(), 1, payload.size(), file) == payload.size();
+
+    if (fclose(file) || !written || rename(temporary.c_str(), path.c_str()))
+        remove(temporary.c_str());
+#endif
+}
+
+/// @}
+
+/// @ingroup Public Static Methods
+/// @{
+
+/**
+ * @brief Returns the program given to the interpreter, loaded from its cache
+ *      when this is up to date; otherwise the program is parsed and compiled,
+ *      then cached
+ */
+Program Bytecode::Load()
+{
+    xword time = 0;
+    bool exists = false;
+
+#if defined(__unix__)
+    struct stat status;
+    Program program;
+
+    if (!stat(Environment::ProgramFilename(), &status) && S_ISREG(status.st_mode))
+    {
+        exists = true;
+        time = status.st_mtim.tv_sec * 1000000000ull + status.st_mtim.tv_nsec;
+        if (Read(program, status.st_size, time, nullptr))
+            return program;
+    }
+#endif
+
+    return Parser::WithSource([&] (const char* source, xword size) {
+        xword checksum = Checksum(source, size);
+        Program program;
+
+        if (exists && Read(program, size, time, &checksum))
+        {
+            Write(program, size, time, checksum);
+            return program;
+        }
+
+        program = Program(Parser::Parse(source, size));
+        if (exists)
+            Write(program, size, time, checksum);
+        return program;
+    });
+}
+
+/// @}
+
+#endif  // BYTECODE_HPP
@@ -7,30 +7,76 @@
 #define ENVIRONMENT_HPP
 
 #include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <string>
 #include "Typedefs.hpp"
+#include "LimbOps.hpp"
+#include "RadixOps.hpp"
+#include "Output.hpp"
+
+#if defined(__unix__)
+#include <unistd.h>
+#endif
 
 /**
  * @class Environment
  * @brief Contains data & functions that represents
  *        the execution environment of the interpreter
- *        including program arguments
+ *        including program arguments and options (given
+ *        anywhere on the command line, prefixed by --)
+ * @details The data of a run (the program and the base) is kept per thread,
+ *          so that several programs can run in the same process (the jobs
+ *          of a batch); the exits of such a contained run end only the run,
+ *          throwing its exit status to the thread that started it
  */
 class Environment
 {
+    /// @defgroup Nested Types
+    public:
+        // The exit of a contained run (its status and the index of the
+        // faulting instruction)
+        struct Exit
+        {
+            int status;
+            xword index;
+
+            std::string Message() const;
+        };
+
     /// @defgroup Static Fields
     private:
-        static byte base;
-        static const char* programFilename;
+        static thread_local byte base;
+        static thread_local const char* programFilename;
+        static thread_local bool contained;
+        static bool batched;
+        static bool serving;
+        static bool reference;
+        static bool native;
+        static bool cachedTop;
+        static bool cache;
 
     /// @defgroup Static Getters & Setters
     public:
         static byte Base();
         static const char* ProgramFilename();
+        static bool Contained();
+        static bool Batched();
+        static bool Serving();
+        static bool Reference();
+        static bool Native();
+        static bool CachedTop();
+        static bool Cache();
+
+    /// @defgroup Private Static Methods
+    private:
+        static void Leave(int status, xword index);
 
     /// @defgroup Static Methods
     public:
         static void Initialize(int argCount, char** argValues);
+        static void Contain(const char* programFilename, byte base);
+        static void Tune();
         static void ExitNormal();
         static void ExitError(xword instructionIndex);
         static void ExitException(xword instructionIndex);
@@ -39,14 +85,64 @@ class Environment
 
 /// @ingroup Static Methods
 /// @{
-inline byte Environment::base;
-inline const char* Environment::programFilename;
+inline thread_local byte Environment::base;
+inline thread_local const char* Environment::programFilename;
+inline thread_local bool Environment::contained = false;
+inline bool Environment::batched = false;
+inline bool Environment::serving = false;
+inline bool Environment::reference = false;
+inline bool Environment::native = false;
+inline bool Environment::cachedTop = false;
+inline bool Environment::cache = false;
 /// @}
 
 /// @defgroup Static Getters & Setters
 /// @{
 INLINE byte Environment::Base() { return base; }
 INLINE const char* Environment::ProgramFilename() { return programFilename; }
+INLINE bool Environment::Contained() { return contained; }
+INLINE bool Environment::Batched() { return batched; }
+INLINE bool Environment::Serving() { return serving; }
+INLINE bool Environment::Reference() { return reference; }
+INLINE bool Environment::Native() { return native; }
+INLINE bool Environment::CachedTop() { return cachedTop; }
+INLINE bool Environment::Cache() { return cache; }
+/// @}
+
+/// @ingroup Nested Types
+/// @{
+
+// Returns the error message of the exit (empty for a normal one)
+INLINE std::string Environment::Exit::Message() const
+{
+    switch (status)
+    {
+        case -1: return "Error:" + std::to_string(index);
+        case -2: return "Exception:" + std::to_string(index);
+        default: return std::string();
+    }
+}
+
+/// @}
+
+/// @ingroup Private Static Methods
+/// @{
+
+// Ends the process (or the current run if it is contained) with a status,
+// printing the error message of the faulting instruction
+INLINE void Environment::Leave(int status, xword index)
+{
+    Exit leave { status, index };
+    std::string message = leave.Message();
+
+    if (contained)
+        throw leave;
+
+    if (!message.empty())
+        std::cerr << message << std::endl;
+    exit(status);
+}
+
 /// @}
 
 /// @ingroup Static Methods
@@ -54,6 +150,57 @@ INLINE const char* Environment::ProgramFilename() { return programFilename; }
 
 INLINE void Environment::Initialize(int argCount, char** argValues)
 {
+    int positionalCount = 1;
+
+#if defined(__unix__)
+    Output::LineBuffered(isatty(STDOUT_FILENO));
+#endif
+    for (int index = 1; index < argCount; ++index)
+    {
+        if (strncmp(argValues[index], "--", 2))
+        {
+            argValues[positionalCount++] = argValues[index];
+        }
+        else if (!strcmp(argValues[index], "--batch"))
+        {
+            batched = true;
+        }
+        else if (!strcmp(argValues[index], "--serve"))
+        {
+            serving = true;
+        }
+        else if (!strcmp(argValues[index], "--reference"))
+        {
+            reference = true;
+        }
+        else if (!strcmp(argValues[index], "--jit"))
+        {
+            native = true;
+        }
+        else if (!strcmp(argValues[index], "--cached-top"))
+        {
+            cachedTop = true;
+        }
+        else if (!strcmp(argValues[index], "--cache"))
+        {
+            cache = true;
+        }
+        else if (!strcmp(argValues[index], "--line-buffered"))
+        {
+            Output::LineBuffered(true);
+        }
+        else if (!strcmp(argValues[index], "--async-output"))
+        {
+            Output::Pipelined(true);
+        }
+        else
+        {
+            std::cerr << "Invalid option." << std::endl;
+            exit(-100);
+        }
+    }
+    argCount = positionalCount;
+
     if (argCount < 2 || argCount > 3)
     {
         std::cerr << "Invalid number of arguments." << std::endl;
@@ -66,23 +213,55 @@ INLINE void Environment::Initialize(int argCount, char** argValues)
         std::cerr << "Invalid base." << std::endl;
         exit(-100);
     } 
+    Tune();
+}
+
+// Starts a contained run of a program in the calling thread
+INLINE void Environment::Contain(const char* programFilename, byte base)
+{
+    Environment::programFilename = programFilename;
+    Environment::base = base;
+    contained = true;
+}
+
+/**
+ * @brief Applies the tuning parameters (calibrated for the host) given
+ *      through environment variables
+ */
+INLINE void Environment::Tune()
+{
+    if (const char* value = getenv("GLYPHO_KARATSUBA_THRESHOLD"))
+        LimbOps::KaratsubaThreshold(std::strtoull(value, nullptr, 10));
+    if (const char* value = getenv("GLYPHO_TOOM3_THRESHOLD"))
+        LimbOps::Toom3Threshold(std::strtoull(value, nullptr, 10));
+    if (const char* value = getenv("GLYPHO_NTT_THRESHOLD"))
+        LimbOps::NttThreshold(std::strtoull(value, nullptr, 10));
+    if (const char* value = getenv("GLYPHO_DIVIDE_THRESHOLD"))
+        LimbOps::DivideThreshold(std::strtoull(value, nullptr, 10));
+    if (const char* value = getenv("GLYPHO_CONVERSION_THRESHOLD"))
+        RadixOps::ConversionThreshold(std::strtoull(value, nullptr, 10));
+    if (const char* value = getenv("GLYPHO_THREADS"))
+        Parallel::Threads(std::strtoull(value, nullptr, 10));
+    if (const char* value = getenv("GLYPHO_PARALLEL_THRESHOLD"))
+        Parallel::Threshold(std::strtoull(value, nullptr, 10));
 }
 
 INLINE void Environment::ExitNormal()
 {
-    exit(0);
+    Output::Close();
+    Leave(0, 0);
 }
 
 INLINE void Environment::ExitError(xword instructionIndex)
 {
-    std::cerr << "Error:" << instructionIndex << std::endl;
-    exit(-1);
+    Output::Close();
+    Leave(-1, instructionIndex);
 }
 
 INLINE void Environment::ExitException(xword instructionIndex)
 {
-    std::cerr << "Exception:" << instructionIndex << std::endl;
-    exit(-2);
+    Output::Close();
+    Leave(-2, instructionIndex);
 }
 
 /// @}
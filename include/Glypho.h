@@ -0,0 +1,129 @@
+/// ============================
+/// @author Andrei Biu - Pislaru
+/// @brief Embedding interface of the interpreter (C ABI & C++ wrapper)
+/// ============================
+
+#ifndef GLYPHO_H
+#define GLYPHO_H
+
+#include <stddef.h>
+
+#if defined(GLYPHO_LIBRARY)
+#define GLYPHO_API __attribute__((visibility("default")))
+#else
+#define GLYPHO_API
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief The statuses returned by the interface, the same as the exit statuses
+ *      of an interpreter process (an error or an exception also gives the
+ *      index of its instruction)
+ */
+enum
+{
+    GLYPHO_OK = 0,
+    GLYPHO_ERROR = -1,          // a parse error
+    GLYPHO_EXCEPTION = -2,      // a run time exception
+    GLYPHO_INVALID = -100       // an invalid argument (or out of memory)
+};
+
+/**
+ * @brief A compiled program; it is immutable, so it can be run any number of
+ *      times, from any number of threads at once
+ */
+typedef struct glypho_program glypho_program;
+
+/**
+ * @brief Receives the output of a run in blocks (numbers followed by new
+ *      lines, never split across blocks), with the context given to the run;
+ *      it must not run programs itself
+ */
+typedef void (*glypho_write)(const char* data, size_t size, void* context);
+
+/**
+ * @brief Parses and compiles a program from a span of bytes, in the 4 symbols
+ *      form (.gly) or, if shorthand is not zero, in the shorthand form (.gsh);
+ *      on success the program is stored in program, otherwise the index of
+ *      the faulting instruction is stored in index (if not null)
+ */
+GLYPHO_API int glypho_parse(const char* source, size_t size, int shorthand,
+                            glypho_program** program, size_t* index);
+
+/**
+ * @brief Runs a program in the calling thread, reading the numbers of the
+ *      input span and passing the output (in base, from 2 to 37) to write
+ *      (discarded if null); on an exception the index of its instruction is
+ *      stored in index (if not null)
+ */
+GLYPHO_API int glypho_run(const glypho_program* program, const char* input, size_t inputSize,
+                          unsigned base, glypho_write write, void* context, size_t* index);
+
+// Releases a program (null is ignored)
+GLYPHO_API void glypho_free(glypho_program* program);
+
+#ifdef __cplusplus
+}
+
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace Glypho
+{
+    // The outcome of a parse or a run
+    struct Result
+    {
+        int status;
+        size_t index;
+
+        explicit operator bool() const { return status == GLYPHO_OK; }
+    };
+
+    /**
+     * @class Script
+     * @brief Owns a compiled program (shared by its copies, since it is
+     *        immutable) and runs it over strings
+     */
+    class Script
+    {
+        /// @defgroup Fields
+        private:
+            std::shared_ptr<glypho_program> program;
+
+        /// @defgroup Public Static Methods
+        public:
+            // Parses a program, storing it in script on success
+            static Result Parse(std::string_view source, bool shorthand, Script& script)
+            {
+                glypho_program* program = nullptr;
+                Result result { GLYPHO_OK, 0 };
+
+                result.status = glypho_parse(source.data(), source.size(), shorthand, &program, &result.index);
+                if (program)
+                    script.program.reset(program, glypho_free);
+                return result;
+            }
+
+        /// @defgroup Methods
+        public:
+            // Runs the program, appending its output to output
+            Result Run(std::string_view input, std::string& output, unsigned base = 10) const
+            {
+                Result result { GLYPHO_OK, 0 };
+                auto append = [] (const char* data, size_t size, void* context) {
+                    static_cast<std::string*>(context)->append(data, size);
+                };
+
+                result.status = glypho_run(program.get(), input.data(), input.size(), base,
+                                           append, &output, &result.index);
+                return result;
+            }
+    };
+}
+#endif
+
+#endif  // GLYPHO_H
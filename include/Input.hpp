@@ -0,0 +1,230 @@
+/// ============================
+/// @author Andrei Biu - Pislaru
+/// @brief Implementation of Input "static" class
+/// ============================
+
+#ifndef INPUT_HPP
+#define INPUT_HPP
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include "Output.hpp"
+
+#if defined(__unix__)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifndef GLYPHO_INPUT_CAPACITY
+#define GLYPHO_INPUT_CAPACITY 65536
+#endif
+
+/**
+ * @class Input
+ * @brief Splits the standard input into whitespace separated tokens (the
+ *        numbers read by the programs), returned as views into its buffer
+ * @details A regular file is memory mapped whole; other inputs (pipes,
+ *          terminals) are read in large blocks, the token at the end of a
+ *          block being moved to the start of the buffer before reading the
+ *          next one (the buffer grows for tokens longer than it). As with
+ *          a stream tied to the output, the buffered output is flushed
+ *          before waiting for more input. The tokens are the ones a
+ *          formatted stream read would give, an empty token marking the
+ *          end of the input. The input is the standard one unless a
+ *          thread opens another descriptor or a block of memory (for its
+ *          contained runs)
+ * @note All members are static (and per thread) to simplify the singleton
+ *       pattern
+ */
+class Input
+{
+    /// @defgroup Static Fields
+    private:
+        static thread_local int descriptor;
+        static thread_local bool mapped;
+        static thread_local bool borrowed;
+        static thread_local char* buffer;
+        static thread_local xword capacity;
+        static thread_local xword size;
+        static thread_local xword position;
+        static thread_local bool finished;
+
+    /// @defgroup Private Static Methods
+    private:
+        static bool IsWhitespace(char symbol);
+        static void Release();
+        static bool Fill(xword& start);
+
+    /// @defgroup Static Methods
+    public:
+        static void Open(int descriptor);
+        static void Open(const char* data, xword size);
+        static std::string_view Next();
+};
+
+
+/// @ingroup Static Fields
+/// @{
+inline thread_local int Input::descriptor = 0;
+inline thread_local bool Input::mapped = false;
+inline thread_local bool Input::borrowed = false;
+inline thread_local char* Input::buffer = nullptr;
+inline thread_local xword Input::capacity = 0;
+inline thread_local xword Input::size = 0;
+inline thread_local xword Input::position = 0;
+inline thread_local bool Input::finished = false;
+/// @}
+
+/// @ingroup Private Static Methods
+/// @{
+
+INLINE bool Input::IsWhitespace(char symbol)
+{
+    return symbol == ' ' || (symbol >= '\t' && symbol <= '\r');
+}
+
+// Releases the buffer (unless it is borrowed) and resets the state
+INLINE void Input::Release()
+{
+#if defined(__unix__)
+    if (mapped)
+        munmap(buffer, size);
+    else if (!borrowed)
+        free(buffer);
+#else
+    if (!borrowed)
+        free(buffer);
+#endif
+
+    mapped = borrowed = false;
+    buffer = nullptr;
+    capacity = size = position = 0;
+    finished = false;
+}
+
+/**
+ * @brief Moves the bytes from start to the beginning of the buffer (start and
+ *      position following them) and reads more of the input after them;
+ *      returns false at the end of the input
+ */
+bool Input::Fill(xword& start)
+{
+#if defined(__unix__)
+    if (finished)
+        return false;
+
+    // The first fill maps the input if it is a regular file
+    if (!buffer)
+    {
+        struct stat status;
+        off_t offset = lseek(descriptor, 0, SEEK_CUR);
+
+        if (!fstat(descriptor, &status) && S_ISREG(status.st_mode) && offset >= 0 && offset < status.st_size)
+        {
+            void* data = mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+            if (data != MAP_FAILED)
+            {
+                buffer = (char*) data;
+                mapped = true;
+                start = position = offset;
+                size = status.st_size;
+                finished = true;
+                return true;
+            }
+        }
+    }
+
+    if (size > start)
+        memmove(buffer, buffer + start, size - start);
+    size -= start;
+    position -= start;
+    start = 0;
+    if (size == capacity)
+    {
+        capacity = std::max<xword>(2 * capacity, GLYPHO_INPUT_CAPACITY);
+        buffer = (char*) realloc(buffer, capacity);
+    }
+
+    ssize_t count;
+    Output::Flush();
+    do
+        count = read(descriptor, buffer + size, capacity - size);
+    while (count < 0 && errno == EINTR);
+
+    if (count <= 0)
+    {
+        finished = true;
+        return false;
+    }
+    size += count;
+    return true;
+#else
+    return false;
+#endif
+}
+
+/// @}
+
+/// @ingroup Static Methods
+/// @{
+
+// Makes the input of the calling thread a descriptor (read from its current
+// offset), releasing the buffer of the previous one
+void Input::Open(int descriptor)
+{
+    Release();
+    Input::descriptor = descriptor;
+}
+
+// Makes the input of the calling thread a block of memory (read in place, so
+// it must outlive the reads), releasing the buffer of the previous one
+void Input::Open(const char* data, xword size)
+{
+    Release();
+    buffer = (char*) data;
+    Input::size = size;
+    borrowed = finished = true;
+}
+
+// Returns the next token of the input (empty at the end of the input), valid
+// until the following call
+std::string_view Input::Next()
+{
+#if defined(__unix__)
+    xword start;
+
+    do
+    {
+        while (position < size && IsWhitespace(buffer[position]))
+            ++position;
+        start = position;
+    }
+    while (position == size && Fill(start));
+
+    // The token might continue in the next blocks
+    do
+    {
+        while (position < size && !IsWhitespace(buffer[position]))
+            ++position;
+    }
+    while (position == size && Fill(start));
+
+    return std::string_view(buffer + start, position - start);
+#else
+    static thread_local std::string token;
+
+    token.clear();
+    std::cin >> token;
+    return token;
+#endif
+}
+
+/// @}
+
+#endif  // INPUT_HPP
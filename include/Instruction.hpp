@@ -6,10 +6,19 @@
 #ifndef INSTRUCTION_HPP
 #define INSTRUCTION_HPP
 
+#include <array>
 #include <cstdlib>
 #include <iostream>
 #include <string>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #include "Environment.hpp"
+#include "Input.hpp"
 #include "Memory.hpp"
 
 /**
@@ -20,6 +29,11 @@
  *        and returns an offset that is used to select the
  *        next instruction; it also has a type that is
  *        convertible to the Glypho .glh symbolic notation 
+ * @details The code of an instruction only depends on which of its
+ *          4 symbols are equal; the 6 pairwise equalities form a pattern
+ *          that is mapped to the code by a table (built from the same
+ *          comparator network used for a single instruction), which lets
+ *          many instructions be decoded at once with vector comparisons
  */
 class Instruction
 {
@@ -45,6 +59,14 @@ class Instruction
             Rbrace   = ']'
         };
 
+    /// @defgroup Static Fields
+    private:
+        static const std::array<byte, 64> patternCodes;
+
+    /// @defgroup Friends
+    friend class Program;
+    friend class Jit;
+
     /// @defgroup Private Static Methods
     private:
         static long HaltOperations(long);
@@ -63,10 +85,13 @@ class Instruction
         static long NegateOperations(long);
         static long PopOperations(long);
         static long RbraceOperations(long);
+        static constexpr std::array<byte, 64> PatternCodes();
 
     /// @defgroup Public Static Methods
     public:
         template <typename T> INLINE static Instruction GetNext(T* symbols);
+        INLINE static Instruction FromCode(byte code);
+        static void Decode(const char* symbols, byte* codes, xword count);
     
     /// @defgroup Fields
     private:
@@ -105,9 +130,7 @@ INLINE long Instruction::NopOperations(long)
 
 INLINE long Instruction::InputOperations(long)
 {
-    std::string input;
-    std::cin >> input;
-    Memory::Push(Integer(input, Environment::Base()));
+    Memory::Push(Integer(Input::Next(), Environment::Base()));
     return 1;
 }
 
@@ -143,9 +166,8 @@ INLINE long Instruction::DupOperations(long)
 
 INLINE long Instruction::AddOperations(long)
 {
-    Integer value0 = Memory::Pop(),
-            value1 = Memory::Pop();
-    Memory::Push(value0 + value1);
+    Integer value = Memory::Pop();
+    Memory::Peek() += value;
     return 1;
 }
 
@@ -159,15 +181,14 @@ INLINE long Instruction::LbraceOperations(long offset)
 
 INLINE long Instruction::OutputOperations(long)
 {
-    std::cout << Memory::Pop().ToString(Environment::Base()) << std::endl;
+    Output::Write(Memory::Pop(), Environment::Base());
     return 1;
 }
 
 INLINE long Instruction::MultiplyOperations(long)
 {
-    Integer value0 = Memory::Pop(),
-            value1 = Memory::Pop();
-    Memory::Push(value0 * value1);
+    Integer value = Memory::Pop();
+    Memory::Peek() *= value;
     return 1;
 }
 
@@ -229,7 +250,14 @@ template <typename T> INLINE Instruction Instruction::GetNext(T* symbols)
         return 9 * flag0 + 3 * (flag1 + flag3) + (flag4 + flag6 + flag7);
     };
 
-    switch (getCode(symbols))
+    return FromCode(getCode(symbols));
+}
+
+// Creates the instruction with the given code (as computed by the comparator
+// network of GetNext)
+INLINE Instruction Instruction::FromCode(byte code)
+{
+    switch (code)
     {
         case  0: return Instruction(Instruction::Type::Nop, 1, NopOperations);
         case  1: return Instruction(Instruction::Type::Input, 1, InputOperations);
@@ -250,4 +278,89 @@ template <typename T> INLINE Instruction Instruction::GetNext(T* symbols)
     }
 }
 
+/**
+ * @brief Decodes the instruction codes of count consecutive groups of 4
+ *      symbols (no whitespace between them); each 32 bit lane holds a group
+ *      and is compared with itself shifted by 1, 2 and 3 symbols, the
+ *      equalities being gathered into the 6 bit pattern of the group
+ */
+void Instruction::Decode(const char* symbols, byte* codes, xword count)
+{
+    xword index = 0;
+
+#if defined(__AVX2__)
+    alignas(32) unsigned patterns[8];
+
+    for (; index + 8 <= count; index += 8)
+    {
+        __m256i group = _mm256_loadu_si256((const __m256i*) (symbols + 4 * index));
+        __m256i equal1 = _mm256_cmpeq_epi8(group, _mm256_srli_epi32(group, 8)),
+                equal2 = _mm256_cmpeq_epi8(group, _mm256_srli_epi32(group, 16)),
+                equal3 = _mm256_cmpeq_epi8(group, _mm256_srli_epi32(group, 24));
+        __m256i pattern = _mm256_or_si256(_mm256_and_si256(equal1, _mm256_set1_epi32(0x010101)),
+                          _mm256_or_si256(_mm256_slli_epi32(_mm256_and_si256(equal2, _mm256_set1_epi32(0x0101)), 1),
+                                          _mm256_slli_epi32(_mm256_and_si256(equal3, _mm256_set1_epi32(0x01)), 2)));
+        pattern = _mm256_or_si256(pattern, _mm256_or_si256(_mm256_srli_epi32(pattern, 5),
+                                                           _mm256_srli_epi32(pattern, 11)));
+        _mm256_store_si256((__m256i*) patterns, _mm256_and_si256(pattern, _mm256_set1_epi32(63)));
+
+        for (xword lane = 0; lane < 8; ++lane)
+            codes[index + lane] = patternCodes[patterns[lane]];
+    }
+#endif
+#if defined(__SSE2__)
+    alignas(16) unsigned quadPatterns[4];
+
+    for (; index + 4 <= count; index += 4)
+    {
+        __m128i group = _mm_loadu_si128((const __m128i*) (symbols + 4 * index));
+        __m128i equal1 = _mm_cmpeq_epi8(group, _mm_srli_epi32(group, 8)),
+                equal2 = _mm_cmpeq_epi8(group, _mm_srli_epi32(group, 16)),
+                equal3 = _mm_cmpeq_epi8(group, _mm_srli_epi32(group, 24));
+        __m128i pattern = _mm_or_si128(_mm_and_si128(equal1, _mm_set1_epi32(0x010101)),
+                          _mm_or_si128(_mm_slli_epi32(_mm_and_si128(equal2, _mm_set1_epi32(0x0101)), 1),
+                                       _mm_slli_epi32(_mm_and_si128(equal3, _mm_set1_epi32(0x01)), 2)));
+        pattern = _mm_or_si128(pattern, _mm_or_si128(_mm_srli_epi32(pattern, 5), _mm_srli_epi32(pattern, 11)));
+        _mm_store_si128((__m128i*) quadPatterns, _mm_and_si128(pattern, _mm_set1_epi32(63)));
+
+        for (xword lane = 0; lane < 4; ++lane)
+            codes[index + lane] = patternCodes[quadPatterns[lane]];
+    }
+#endif
+    for (; index < count; ++index)
+    {
+        const char* group = symbols + 4 * index;
+        unsigned pattern = (group[0] == group[1]) | (group[0] == group[2]) << 1 | (group[0] == group[3]) << 2 |
+                           (group[1] == group[2]) << 3 | (group[1] == group[3]) << 4 | (group[2] == group[3]) << 5;
+        codes[index] = patternCodes[pattern];
+    }
+}
+
+
+/// @ingroup Static Fields
+
+// Builds the table of the instruction codes for all the equality patterns
+// (bit 0: s0 = s1, 1: s0 = s2, 2: s0 = s3, 3: s1 = s2, 4: s1 = s3, 5: s2 = s3)
+constexpr std::array<byte, 64> Instruction::PatternCodes()
+{
+    std::array<byte, 64> codes {};
+
+    for (unsigned pattern = 0; pattern < 64; ++pattern)
+    {
+        bool flag0 = !(pattern & 1),
+             flag1 = !(pattern & 2),
+             flag2 = flag1 && !(pattern & 8),
+             flag3 = flag0 && flag2,
+             flag4 = !(pattern & 4),
+             flag5 = !(pattern & 16),
+             flag6 = flag0 && flag4 && flag5,
+             flag7 = flag2 && flag4 && flag5 && !(pattern & 32);
+        codes[pattern] = 9 * flag0 + 3 * (flag1 + flag3) + (flag4 + flag6 + flag7);
+    }
+
+    return codes;
+}
+
+inline constexpr std::array<byte, 64> Instruction::patternCodes = Instruction::PatternCodes();
+
 #endif  // INSTRUCTION_HPP
@@ -11,10 +11,13 @@
 #include <cstring>
 #include <algorithm>
 #include <string>
+#include <string_view>
 #include <sstream>
 
 #include "Utils.hpp"
 #include "ArithmeticOps.hpp"
+#include "LimbOps.hpp"
+#include "RadixOps.hpp"
 
 /**
  * @class Integer
@@ -25,25 +28,49 @@
  *          Internally the number is stored as an array of digits in the base
  *          2^mbw, with 'mbw' being the bit width (size on bits) of the maximum
  *          biggest hardware - supported unsigned integral type to maximize the
- *          use of hardware instructions    
+ *          use of hardware instructions; numbers of up to localWidth digits
+ *          are kept inline (no heap allocation), the wider ones being moved
+ *          transparently to heap memory; the accumulating operators (+=, *=)
+ *          reuse the storage of the left operand, growing it geometrically    
  */
 class Integer
 {    
+    /// @defgroup Friends
+    friend class Jit;
+
     /// @defgroup Static Methods
     private:
         static bool GreaterAbs(const Integer& left, const Integer& right);
-        static void Add(Integer& left, const Integer& right);
         static void Add(Integer& result, const Integer& left, const Integer& right);
         static void Subtract(Integer& result, const Integer& left, const Integer& right);
         static void Multiply(Integer& result, const Integer& left, const Integer& right);
-        static void Multiply(Integer& integer, byte value);
-        static byte Divide(Integer& integer, byte value);
+
+    /// @defgroup Public Static Methods
+    public:
+        static void ReleaseScratch();
+
+    /// @defgroup Static Fields
+    private:
+        static constexpr xword localWidth = 2;
+        static thread_local xword* scratch;
+        static thread_local xword scratchCapacity;
     
     /// @defgroup Fields
     private:
         bool sign;
         xword width;
+        xword capacity;
         xword* magnitude;
+        xword local[localWidth];
+
+    /// @defgroup Private Methods
+    private:
+        xword* Allocate(xword width);
+        void Release();
+        void Reserve(xword width);
+        void Normalize();
+        void Assign(const Integer& integer);
+        void Steal(Integer& integer);
 
     /// @defgroup Private Constructors
     private:
@@ -55,7 +82,7 @@ class Integer
         Integer(Integer&& integer);
         Integer(xword value, bool sign = 0);
         Integer(xword* magnitude, xword width, bool sign = 0);
-        Integer(std::string numberString, byte base = 10);
+        Integer(std::string_view numberString, byte base = 10);
 
     /// @defgroup Destructor
     public:
@@ -74,19 +101,31 @@ class Integer
         Integer operator + (const Integer& integer) const;
         Integer operator - (const Integer& integer) const;
         Integer operator * (const Integer& integer) const;
+        Integer& operator += (const Integer& integer);
+        Integer& operator *= (const Integer& integer);
         Integer operator + () const;
         Integer operator - () const;
 
     /// @defgroup Methods
     public:
         void Negate();
+        void Halve();
+        void Swap(Integer& integer);
         bool IsZero() const;
         bool IsOne() const;
         bool IsNegative() const;
         bool IsPositive() const;
+        xword ToStringLength(byte base = 10) const;
+        xword ToString(char* string, byte base = 10) const;
         std::string ToString(byte base = 10) const;
 };
 
+/// @ingroup Static Fields
+/// @{
+inline thread_local xword* Integer::scratch = nullptr;
+inline thread_local xword Integer::scratchCapacity = 0;
+/// @}
+
 /// @ingroup Static Methods
 /// @{
 
@@ -102,30 +141,12 @@ INLINE bool Integer::GreaterAbs(const Integer& left, const Integer& right)
     return left.width > right.width;
 }
 
-INLINE void Integer::Add(Integer& left, const Integer& right)
-{
-    xword carry = 0, index = 0;
-
-    while (index < left.width)
-    {
-        left.magnitude[index] = carry + left.magnitude[index] + right.magnitude[index];
-        carry = left.magnitude[index] < right.magnitude[index++]; 
-    }
-    while (index < right.width)
-    {
-        left.magnitude[index] = carry + right.magnitude[index];
-        carry = left.magnitude[index] < right.magnitude[index++]; 
-    }
-    left.magnitude[index] = carry;
-    left.width += (bool) carry;
-}
-
 INLINE void Integer::Add(Integer& result, const Integer& left, const Integer& right)
 {
     if (right.width == 1 && right.magnitude[0] == 0)
     {
         result.width = left.width;
-        result.magnitude = (xword*) malloc(left.width * sizeof(xword));
+        result.magnitude = result.Allocate(left.width);
         memcpy(result.magnitude, left.magnitude, left.width * sizeof(xword));
     }
     else
@@ -133,7 +154,7 @@ INLINE void Integer::Add(Integer& result, const Integer& left, const Integer& ri
         xword carry = 0, index = 0;
 
         result.width = left.width;
-        result.magnitude = (xword*) malloc((left.width + 1) * sizeof(xword));
+        result.magnitude = result.Allocate(left.width + 1);
         while (index < right.width)
         {
             result.magnitude[index] = carry + right.magnitude[index] + left.magnitude[index];
@@ -154,15 +175,15 @@ INLINE void Integer::Subtract(Integer& result, const Integer& left, const Intege
     if (right.width == 1 && right.magnitude[0] == 0)
     {
         result.width = left.width;
-        result.magnitude = (xword*) malloc(left.width * sizeof(xword));
+        result.magnitude = result.Allocate(left.width);
         memcpy(result.magnitude, left.magnitude, left.width * sizeof(xword));
     }
     else
     {
         xword borrow = 0, index = 0;
 
-        result.magnitude = (xword*) malloc(left.width * sizeof(xword));
-        result.width = left.width;
+        result.magnitude = result.Allocate(left.width);
+        result.width = 1;
         while (index < right.width)
         {
             result.magnitude[index] = left.magnitude[index] - right.magnitude[index] - borrow;
@@ -185,14 +206,15 @@ INLINE void Integer::Multiply(Integer& result, const Integer& left, const Intege
         if (right.magnitude[0] == 0)
         {
             result.width = 1;
-            result.magnitude = (xword*) malloc(sizeof(xword));
+            result.capacity = localWidth;
+            result.magnitude = result.local;
             result.magnitude[0] = 0;
             return;
         }
         else if (right.magnitude[0] == 1)
         {
             result.width = left.width;
-            result.magnitude = (xword*) malloc(left.width + sizeof(xword));
+            result.magnitude = result.Allocate(left.width);
             memcpy(result.magnitude, left.magnitude, left.width * sizeof(xword));
         }
         else
@@ -201,7 +223,7 @@ INLINE void Integer::Multiply(Integer& result, const Integer& left, const Intege
             std::pair<xword, xword> temp = std::make_pair(0, 0);
 
             result.width = left.width + 1;
-            result.magnitude = (xword*) malloc(result.width * sizeof(xword));
+            result.magnitude = result.Allocate(result.width);
             while (index < left.width)
             {
                 result.magnitude[index] = temp.first;
@@ -215,105 +237,104 @@ INLINE void Integer::Multiply(Integer& result, const Integer& left, const Intege
     }
     else
     {
-        xword index0 = 0, index1, index2, carry;
-        std::pair<xword, xword> temp;
-
         result.width = left.width + right.width;
-        result.magnitude = (xword*) calloc(result.width, sizeof(xword));
-        while (index0 < right.width)
-        {
-            index1 = 0;
-            index2 = index0;
-            temp = std::make_pair(0, 0);
-
-            while (index1 < left.width)
-            {
-                result.magnitude[index2] += temp.first;
-                carry = result.magnitude[index2] < temp.first;
-                temp = ArithmeticOps::Multiply(left.magnitude[index1++], right.magnitude[index0]);
-                result.magnitude[index2] += temp.second;
-                carry += (result.magnitude[index2++] < temp.second);
-                temp.first += carry;
-            }
-            result.magnitude[index2] += temp.first;
-            temp.first = result.magnitude[index2] < temp.first;
-            ++index0;
-        }
-        result.width -= result.magnitude[index2] == 0;
+        result.magnitude = result.Allocate(result.width);
+        if (&left == &right || (left.width == right.width &&
+                                !memcmp(left.magnitude, right.magnitude, left.width * sizeof(xword))))
+            LimbOps::Square(result.magnitude, left.magnitude, left.width);
+        else
+            LimbOps::Multiply(result.magnitude, left.magnitude, left.width, right.magnitude, right.width);
+        result.width -= result.magnitude[result.width - 1] == 0;
     }
 }
 
-INLINE void Integer::Multiply(Integer& integer, byte value)
+/// @}
+
+/// @ingroup Public Static Methods
+/// @{
+
+// Frees the scratch buffer of the calling thread
+INLINE void Integer::ReleaseScratch()
 {
-    xword aux, index = 0;
-    std::pair<xword, xword> temp = std::make_pair(0, 0);
+    free(scratch);
+    scratch = nullptr;
+    scratchCapacity = 0;
+}
 
-    while (index < integer.width)
+/// @}
+
+/// @ingroup Private Methods
+/// @{
+
+// Returns the inline digits if they are enough, otherwise heap memory
+INLINE xword* Integer::Allocate(xword width)
+{
+    if (width <= localWidth)
     {
-        aux = temp.first;
-        temp = ArithmeticOps::Multiply(integer.magnitude[index], value);
-        integer.magnitude[index] = aux;
-        integer.magnitude[index] += temp.second;
-        temp.first += integer.magnitude[index++] < temp.second; 
+        capacity = localWidth;
+        return local;
     }
-    integer.magnitude[index] = temp.first;
-    integer.width += temp.first != 0;
+
+    capacity = width;
+    return (xword*) malloc(width * sizeof(xword));
 }
 
-INLINE byte Integer::Divide(Integer& integer, byte value)
+INLINE void Integer::Release()
 {
-	std::pair<xword, xword> temp;
-    
-    if (integer.width > 1)
-    {
-        xword index0, index1 = 0;
-        xword* aux = (xword*) malloc(integer.width * sizeof(xword));
+    if (magnitude != local)
+        free(magnitude);
+}
 
-        while (integer.width)
+// Ensures room for width digits (keeping the current ones), at least doubling the capacity
+INLINE void Integer::Reserve(xword width)
+{
+    if (width > capacity)
+    {
+        capacity = std::max(width, capacity << 1);
+        if (magnitude == local)
         {
-            index0 = integer.width - 1;
-            if (integer.magnitude[index0] == 0)
-            {
-                aux[index1++] = 0;
-                temp.second = 0;
-                --integer.width;
-            }
-            else if (value > integer.magnitude[index0])
-            {
-                if (integer.width > 1)
-                {
-                    temp = ArithmeticOps::Divide(integer.magnitude[index0], integer.magnitude[index0 - 1], value);
-                    aux[index1++] = temp.first;
-                    integer.magnitude[index0 - 1] = temp.second;
-                    integer.width -= 1 + (temp.second == 0);
-                }
-                else
-                {
-                    temp.second = integer.magnitude[index0];
-                    --integer.width;
-                }
-            }
-            else
-            {
-                temp = ArithmeticOps::Divide(0, integer.magnitude[index0], value);
-                aux[index1++] = temp.first;
-                integer.magnitude[index0] = temp.second;
-                integer.width -= temp.second == 0;
-            }
+            magnitude = (xword*) malloc(capacity * sizeof(xword));
+            memcpy(magnitude, local, this->width * sizeof(xword));
         }
+        else
+        {
+            magnitude = (xword*) realloc(magnitude, capacity * sizeof(xword));
+        }
+    }
+}
 
-        integer.width = index1;
-        std::reverse(aux, aux + index1);
-        free(integer.magnitude);
-        integer.magnitude = aux;
+// Removes the leading zero digits and the sign of zero
+INLINE void Integer::Normalize()
+{
+    while (width > 1 && magnitude[width - 1] == 0)
+        --width;
+    sign = sign && !IsZero();
+}
+
+INLINE void Integer::Assign(const Integer& integer)
+{
+    sign = integer.sign;
+    width = integer.width;
+    magnitude = Allocate(width);
+    memcpy(magnitude, integer.magnitude, width * sizeof(xword));
+}
+
+// Takes the heap digits of integer or copies its inline ones
+INLINE void Integer::Steal(Integer& integer)
+{
+    sign = integer.sign;
+    width = integer.width;
+    capacity = integer.capacity;
+    if (integer.magnitude == integer.local)
+    {
+        magnitude = local;
+        memcpy(local, integer.local, width * sizeof(xword));
     }
     else
     {
-        temp = ArithmeticOps::Divide(0, integer.magnitude[integer.width - 1], value);
-        integer.magnitude[integer.width - 1] = temp.first;
+        magnitude = integer.magnitude;
+        integer.magnitude = nullptr;
     }
-
-    return temp.second;
 }
 
 /// @}
@@ -324,131 +345,43 @@ INLINE Integer::Integer() {}
 /// @ingroup Public Constructors
 /// @{
 
-INLINE Integer::Integer(const Integer& integer) : sign(integer.sign), width(integer.width)
+INLINE Integer::Integer(const Integer& integer)
 {
-    magnitude = (xword*) malloc(width * sizeof(xword));
-    memcpy(magnitude, integer.magnitude, width * sizeof(xword));
+    Assign(integer);
 }
 
-INLINE Integer::Integer(Integer&& integer) : sign(integer.sign), width(integer.width), magnitude(integer.magnitude)
+INLINE Integer::Integer(Integer&& integer)
 {
-	integer.magnitude = nullptr;
+	Steal(integer);
 }
 
-Integer::Integer(xword value, bool sign) : sign(sign), width(1)
+INLINE Integer::Integer(xword value, bool sign) : sign(sign), width(1), capacity(localWidth), magnitude(local)
 {
-	magnitude = (xword*) malloc(sizeof(xword));
     *magnitude = value;
 }
 
-Integer::Integer(xword* magnitude, xword width, bool sign) : sign(sign), width(width), magnitude(magnitude)
+Integer::Integer(xword* magnitude, xword width, bool sign) :
+    sign(sign), width(width), capacity(width), magnitude(magnitude)
 {
 }
 
-Integer::Integer(std::string numberString, byte base)
+Integer::Integer(std::string_view numberString, byte base)
 {
-    xword i, dj, j = 0, length = numberString.length();
+    const char* digits = numberString.data();
+    xword length = numberString.length();
 
-    sign = numberString[j] == '-';
-    j += sign;
+    sign = length && digits[0] == '-';
+    digits += sign;
+    length -= sign;
 
-    if (base == 2)
-    {
-        dj = sizeof(xword) << 3;
-        width = length - sign;
-        length &= dj - 1;
-        width = width / dj + (bool) length;
-        magnitude = (xword*) malloc(width * sizeof(xword));
-        i = width;
-
-        if (length)
-        {
-            magnitude[--i] = Utils::Parse(numberString.substr(sign, length), base);
-            j += length;
-        }
-        while (j != numberString.length())
-        {
-            magnitude[--i] = Utils::Parse(numberString.substr(j, dj), base);
-            j += dj;
-        }
-    }
-    else if (base == 4)
-    {
-        dj = sizeof(xword) << 2;
-        width = length - sign;
-        length &= dj - 1;
-        width = width / dj + (bool) length;
-        magnitude = (xword*) malloc(width * sizeof(xword));
-        i = width;
-
-        if (length)
-        {
-            magnitude[--i] = Utils::Parse(numberString.substr(sign, length), base);
-            j += length;
-        }
-        while (j != numberString.length())
-        {
-            magnitude[--i] = Utils::Parse(numberString.substr(j, dj), base);
-            j += dj;
-        }
-    }
-    else if (base == 16)
-    {
-        dj = sizeof(xword) << 1;
-        width = length - sign;
-        length &= dj - 1;
-        width = width / dj + (bool) length;
-        magnitude = (xword*) malloc(width * sizeof(xword));
-        i = width;
-        
-        if (length)
-        {
-            magnitude[--i] = Utils::Parse(numberString.substr(sign, length), base);
-            j += length;
-        }
-        while (j != numberString.length())
-        {
-            magnitude[--i] = Utils::Parse(numberString.substr(j, dj), base);
-            j += dj;
-        }
-    }
-    else
-    {
-        xword* data;
-        Integer power, digitValue;
-
-        dj = length;
-        length = std::ceil((ArithmeticOps::Log2Ceil(base) * length) / (8.0 * sizeof(xword)));
-        width = length;
-        magnitude = (xword*) calloc(width + 1, sizeof(xword));
-        data = (xword*) calloc(width << 1, sizeof(xword));
-        data[0] = 1;
-        power.width = length; 
-        power.magnitude = data;
-        digitValue.width = length;
-        digitValue.magnitude = data + length;
-    
-        while (dj-- != j)
-        {
-            if (Utils::IsInvalidDigit(numberString[dj], base))
-            {
-                free(data);
-                power.magnitude = nullptr;
-                digitValue.magnitude = nullptr;
-                throw 0;
-            }
-            
-            memcpy(digitValue.magnitude, power.magnitude, width * sizeof(xword));
-            Multiply(digitValue, Utils::ToNumber(numberString[dj]));
-            Add(*this, digitValue);
-            Multiply(power, base);
-        }
-        width -= width > 1 && magnitude[width - 1] == 0;
-    
-        free(data);
-        power.magnitude = nullptr;
-        digitValue.magnitude = nullptr;
-    }
+    if (!length)
+        throw 0;
+    for (xword index = 0; index < length; ++index)
+        if (Utils::IsInvalidDigit(digits[index], base))
+            throw 0;
+
+    magnitude = Allocate(RadixOps::FromStringWidth(length, base));
+    width = RadixOps::FromString(magnitude, digits, length, base);
 
     if (IsZero())
         sign = 0;
@@ -459,7 +392,7 @@ Integer::Integer(std::string numberString, byte base)
 /// @ingroup Destructor
 INLINE Integer::~Integer()
 {
-    free(magnitude);
+    Release();
 }
 
 /// @ingroup Operators
@@ -551,21 +484,22 @@ bool Integer::operator >= (const Integer& integer) const
 
 Integer& Integer::operator = (const Integer& integer)
 {
-	sign = integer.sign;
-    width = integer.width;
-    free(magnitude);
-    magnitude = (xword*) malloc(width * sizeof(xword));
-    memcpy(magnitude, integer.magnitude, width * sizeof(xword));
+    if (this != &integer)
+    {
+        Release();
+        Assign(integer);
+    }
 
     return *this;
 }
 
 Integer& Integer::operator = (Integer&& integer)
 {
-	sign = integer.sign;
-    width = integer.width;
-    magnitude = integer.magnitude;
-    integer.magnitude = nullptr;
+    if (this != &integer)
+    {
+        Release();
+        Steal(integer);
+    }
 
     return *this;
 }
@@ -618,6 +552,92 @@ Integer Integer::operator * (const Integer& integer) const
     return result;
 }
 
+Integer& Integer::operator += (const Integer& integer)
+{
+    if (sign == integer.sign)
+    {
+        xword resultWidth = std::max(width, integer.width);
+
+        Reserve(resultWidth + 1);
+        std::fill(magnitude + width, magnitude + resultWidth, 0);
+        width = resultWidth;
+        magnitude[width] = LimbOps::AddInPlace(magnitude, width, integer.magnitude, integer.width);
+        width += magnitude[width] != 0;
+    }
+    else if (!GreaterAbs(integer, *this))
+    {
+        LimbOps::SubtractInPlace(magnitude, width, integer.magnitude, integer.width);
+        Normalize();
+    }
+    else
+    {
+        Reserve(integer.width);
+        std::fill(magnitude + width, magnitude + integer.width, 0);
+        LimbOps::Subtract(magnitude, integer.magnitude, integer.width, magnitude, integer.width);
+        width = integer.width;
+        sign = integer.sign;
+        Normalize();
+    }
+
+    return *this;
+}
+
+/**
+ * @details Single digit factors are multiplied in place; otherwise the
+ *      product goes to a shared scratch buffer which then replaces the
+ *      digits of this integer (the old ones becoming the next scratch)
+ */
+Integer& Integer::operator *= (const Integer& integer)
+{
+    if (integer.width == 1 || width == 1)
+    {
+        const Integer& wide = integer.width == 1 ? *this : integer;
+        xword value = integer.width == 1 ? integer.magnitude[0] : magnitude[0], resultWidth = wide.width;
+
+        Reserve(resultWidth + 1);
+        magnitude[resultWidth] = LimbOps::Multiply(magnitude, wide.magnitude, resultWidth, value);
+        width = resultWidth + 1;
+    }
+    else
+    {
+        xword resultWidth = width + integer.width;
+
+        if (scratchCapacity < resultWidth)
+        {
+            free(scratch);
+            scratchCapacity = std::max(resultWidth, scratchCapacity << 1);
+            scratch = (xword*) malloc(scratchCapacity * sizeof(xword));
+        }
+
+        if (this == &integer || (width == integer.width &&
+                                 !memcmp(magnitude, integer.magnitude, width * sizeof(xword))))
+            LimbOps::Square(scratch, magnitude, width);
+        else if (width >= integer.width)
+            LimbOps::Multiply(scratch, magnitude, width, integer.magnitude, integer.width);
+        else
+            LimbOps::Multiply(scratch, integer.magnitude, integer.width, magnitude, width);
+
+        if (magnitude == local)
+        {
+            magnitude = scratch;
+            capacity = scratchCapacity;
+            scratch = nullptr;
+            scratchCapacity = 0;
+        }
+        else
+        {
+            std::swap(magnitude, scratch);
+            std::swap(capacity, scratchCapacity);
+        }
+        width = resultWidth;
+    }
+
+    sign = sign != integer.sign;
+    Normalize();
+
+    return *this;
+}
+
 Integer Integer::operator + () const
 {
 	return *this;
@@ -641,6 +661,29 @@ INLINE void Integer::Negate()
     sign = !sign;
 }
 
+// Divides an even number by 2
+INLINE void Integer::Halve()
+{
+    LimbOps::ShiftRight(magnitude, magnitude, width, 1);
+    Normalize();
+}
+
+// Exchanges the values (the inline digits by copy, the heap ones by pointer)
+INLINE void Integer::Swap(Integer& integer)
+{
+    bool local = magnitude == this->local, otherLocal = integer.magnitude == integer.local;
+
+    std::swap(sign, integer.sign);
+    std::swap(width, integer.width);
+    std::swap(capacity, integer.capacity);
+    std::swap(magnitude, integer.magnitude);
+    std::swap(this->local, integer.local);
+    if (otherLocal)
+        magnitude = this->local;
+    if (local)
+        integer.magnitude = integer.local;
+}
+
 INLINE bool Integer::IsZero() const
 {
 	return width == 1 && magnitude[0] == 0;
@@ -661,52 +704,35 @@ INLINE bool Integer::IsPositive() const
 	return !sign;
 }
 
-std::string Integer::ToString(byte base) const
+// Upper bound for the number of characters of the representation in base
+INLINE xword Integer::ToStringLength(byte base) const
+{
+    return IsZero() ? 1 : sign + RadixOps::ToStringLength(magnitude, width, base);
+}
+
+/**
+ * @brief Writes the representation in base to string (with room for at
+ *      least ToStringLength characters) and returns its length
+ */
+INLINE xword Integer::ToString(char* string, byte base) const
 {
     if (IsZero())
-        return "0";
-    
-    if (base == 2)
     {
-        xword lastOneIndex = 0, index0 = 0;
-        std::string string;
-
-        while (index0 < width)
-        {
-            xword mask = 1, index1 = 0;
-            do
-            {
-                bool isOne = (bool)(magnitude[index0] & mask);
-                string.push_back('0' + isOne);
-                lastOneIndex = isOne ? index1 : lastOneIndex;
-                ++index1;
-                mask <<= 1;
-            } while (mask);
-            ++index0;
-        }
-
-        string.erase(
-            string.begin() + ((width - 1) * (sizeof(xword) << 3) + lastOneIndex + 1),
-            string.end()
-        );
-        std::reverse(string.begin(), string.end());
-        string.insert(0, sign ? "-" : "");
-
-        return string;
+        *string = '0';
+        return 1;
     }
-    else
-    {
-        Integer number = *this;
-        std::string string;
 
-        while(!number.IsZero())
-           string.push_back(Utils::ToDigit(Divide(number, base)));
-        std::reverse(string.begin(), string.end());
-        if (sign)
-            string.insert(0, "-");
+    if (sign)
+        *string = '-';
+    return sign + RadixOps::ToString(string + sign, magnitude, width, base);
+}
 
-        return string;
-    }
+std::string Integer::ToString(byte base) const
+{
+    std::string string(ToStringLength(base), '0');
+
+    string.resize(ToString(string.data(), base));
+    return string;
 }
 
 /// @}
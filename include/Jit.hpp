@@ -0,0 +1,420 @@
+/// ============================
+/// @author Andrei Biu - Pislaru
+/// @brief Implementation of the x86-64 Jit compiler
+/// ============================
+
+#ifndef JIT_HPP
+#define JIT_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <vector>
+
+#include "Instruction.hpp"
+#include "Loop.hpp"
+#include "Memory.hpp"
+#include "Opcode.hpp"
+
+#if defined(__x86_64__) && defined(__unix__)
+#define GLYPHO_JIT 1
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+/**
+ * @class Jit
+ * @brief Translates compiled Glypho code (opcodes, offsets & operands) to
+ *        native x86-64 code in an executable memory mapping
+ * @details Each opcode becomes a call to a runtime helper that performs the
+ *          operation on the memory and returns a status; the braces and the
+ *          constant additions also have inline fast paths for single digit
+ *          values. The helpers never throw (the native frames have no unwind
+ *          information): an exception or a deoptimization is returned to the
+ *          caller together with the position of the opcode that caused it, as
+ *          (position << 2) | status
+ */
+class Jit
+{
+    /// @defgroup Nested Types
+    public:
+        enum Status : xword
+        {
+            Finished   = 0,
+            Exception  = 1,
+            Deoptimize = 2,
+            Taken      = 3      // branch taken (zero at the top of the memory)
+        };
+
+    /// @defgroup Static Fields
+    private:
+        static constexpr xword maxOpcodeSize = 192;
+
+    /// @defgroup Fields
+    private:
+        byte* code;
+        xword size;
+        xword length;
+        std::vector<xword> addresses;
+        std::vector<std::pair<xword, xword>> patches;
+
+    /// @defgroup Runtime Helpers
+    private:
+        template <long (*operations)(long)> static xword Call(long operand);
+        static xword LbraceHelper(long);
+        static xword PushConstantHelper(long value);
+        static xword AddConstantHelper(long value);
+        static xword SquareHelper(long);
+        static xword DoubleHelper(long);
+        static xword RotateHelper(long count);
+        static xword LoopHelper(long loop);
+
+    /// @defgroup Private Methods
+    private:
+        void Emit(std::initializer_list<byte> bytes);
+        void Emit32(std::uint32_t value);
+        void Emit64(std::uint64_t value);
+        xword EmitJump(std::initializer_list<byte> opcode);
+        void Bind(xword location);
+        void EmitExit(xword position, bool fromHelper);
+        void EmitTop(xword& slow);
+        void EmitCall(Function<xword, long> helper, long operand, xword position);
+        void EmitLbrace(xword position, long offset);
+        void EmitAddConstant(xword position, long value);
+        void Translate(const byte* opcodes, const long* offsets, const long* operands, const Loop* loops,
+                       xword count);
+
+    /// @defgroup Constructors & Destructor
+    public:
+        Jit(const byte* opcodes, const long* offsets, const long* operands, const Loop* loops, xword count);
+        Jit(const Jit&) = delete;
+        ~Jit();
+
+    /// @defgroup Methods
+    public:
+        bool Compiled() const;
+        xword operator () () const;
+};
+
+
+/// @ingroup Runtime Helpers
+/// @{
+
+template <long (*operations)(long)> xword Jit::Call(long operand)
+{
+    try
+    {
+        operations(operand);
+        return Status::Finished;
+    }
+    catch (...)
+    {
+        return Status::Exception;
+    }
+}
+
+xword Jit::LbraceHelper(long)
+{
+    if (Memory::Size() == 0)
+        return Status::Exception;
+    return Memory::Peek().IsZero() ? Status::Taken : Status::Finished;
+}
+
+xword Jit::PushConstantHelper(long value)
+{
+    Memory::Push(Integer(value < 0 ? -value : value, value < 0));
+    return Status::Finished;
+}
+
+xword Jit::AddConstantHelper(long value)
+{
+    if (Memory::Size() == 0)
+        return Status::Deoptimize;
+    Memory::Peek() += Integer(value < 0 ? -value : value, value < 0);
+    return Status::Finished;
+}
+
+xword Jit::SquareHelper(long)
+{
+    if (Memory::Size() == 0)
+        return Status::Deoptimize;
+    Memory::Peek() *= Memory::Peek();
+    return Status::Finished;
+}
+
+xword Jit::DoubleHelper(long)
+{
+    if (Memory::Size() == 0)
+        return Status::Deoptimize;
+    Memory::Peek() += Memory::Peek();
+    return Status::Finished;
+}
+
+xword Jit::RotateHelper(long count)
+{
+    if (Memory::Size() == 0)
+        return Status::Deoptimize;
+    Memory::Rotate(count);
+    return Status::Finished;
+}
+
+// The operand is the address of the loop
+xword Jit::LoopHelper(long loop)
+{
+    try
+    {
+        return ((const Loop*) loop)->Run() ? Status::Finished : Status::Deoptimize;
+    }
+    catch (...)
+    {
+        return Status::Exception;
+    }
+}
+
+/// @}
+
+/// @ingroup Private Methods
+/// @{
+
+INLINE void Jit::Emit(std::initializer_list<byte> bytes)
+{
+    for (byte value : bytes)
+        code[length++] = value;
+}
+
+INLINE void Jit::Emit32(std::uint32_t value)
+{
+    memcpy(code + length, &value, sizeof(value));
+    length += sizeof(value);
+}
+
+INLINE void Jit::Emit64(std::uint64_t value)
+{
+    memcpy(code + length, &value, sizeof(value));
+    length += sizeof(value);
+}
+
+// Emits a jump with a 32 bit displacement and returns its location
+INLINE xword Jit::EmitJump(std::initializer_list<byte> opcode)
+{
+    Emit(opcode);
+    Emit32(0);
+    return length - 4;
+}
+
+// Makes the jump at location target the current end of the code
+INLINE void Jit::Bind(xword location)
+{
+    std::uint32_t displacement = length - (location + 4);
+    memcpy(code + location, &displacement, sizeof(displacement));
+}
+
+// Returns (position << 2) | status, the status being in rax (helper result)
+// or Finished otherwise
+INLINE void Jit::EmitExit(xword position, bool fromHelper)
+{
+    if (!fromHelper)
+        Emit({ 0x31, 0xC0 });                       // xor eax, eax
+    Emit({ 0x48, 0xBA }); Emit64(position << 2);    // mov rdx, position << 2
+    Emit({ 0x48, 0x09, 0xD0 });                     // or rax, rdx
+    Emit({ 0x5B, 0xC3 });                           // pop rbx; ret
+}
+
+// Loads the address of the top of the memory into rax (jumping to the slow
+// location when the memory is empty)
+INLINE void Jit::EmitTop(xword& slow)
+{
+    Emit({ 0x48, 0xB9 }); Emit64((std::uintptr_t) &Memory::size);     // mov rcx, &size
+    Emit({ 0x48, 0x83, 0x39, 0x00 });                                   // cmp qword [rcx], 0
+    slow = EmitJump({ 0x0F, 0x84 });                                    // je slow
+    Emit({ 0x48, 0xB9 }); Emit64((std::uintptr_t) &Memory::head);     // mov rcx, &head
+    Emit({ 0x48, 0x8B, 0x01 });                                         // mov rax, [rcx]
+    Emit({ 0x48, 0x69, 0xC0 }); Emit32(sizeof(Integer));                // imul rax, rax, sizeof
+    Emit({ 0x48, 0xB9 }); Emit64((std::uintptr_t) &Memory::data);     // mov rcx, &data
+    Emit({ 0x48, 0x03, 0x01 });                                         // add rax, [rcx]
+}
+
+// Calls a helper and leaves the native code if it does not return Finished
+INLINE void Jit::EmitCall(Function<xword, long> helper, long operand, xword position)
+{
+    Emit({ 0x48, 0xBF }); Emit64(operand);                              // mov rdi, operand
+    Emit({ 0x48, 0xB8 }); Emit64((std::uintptr_t) helper);              // mov rax, helper
+    Emit({ 0xFF, 0xD0 });                                               // call rax
+    Emit({ 0x48, 0x85, 0xC0 });                                         // test rax, rax
+    xword next = EmitJump({ 0x0F, 0x84 });                              // jz next
+    EmitExit(position, true);
+    Bind(next);
+}
+
+void Jit::EmitLbrace(xword position, long offset)
+{
+    xword slow, nonZero, next;
+
+    // Fast path: a single digit zero at the top
+    EmitTop(slow);
+    Emit({ 0x48, 0x83, 0x78, offsetof(Integer, width), 0x01 });         // cmp qword [rax + width], 1
+    nonZero = EmitJump({ 0x0F, 0x85 });                                 // jne nonZero
+    Emit({ 0x48, 0x8B, 0x48, offsetof(Integer, magnitude) });           // mov rcx, [rax + magnitude]
+    Emit({ 0x48, 0x83, 0x39, 0x00 });                                   // cmp qword [rcx], 0
+    patches.emplace_back(EmitJump({ 0x0F, 0x84 }), position + offset);  // je target
+    Bind(nonZero);
+    next = EmitJump({ 0xE9 });                                          // jmp next
+
+    // Slow path: the helper reports an empty memory
+    Bind(slow);
+    Emit({ 0x48, 0xB8 }); Emit64((std::uintptr_t) LbraceHelper);        // mov rax, helper
+    Emit({ 0xFF, 0xD0 });                                               // call rax
+    Emit({ 0x48, 0x83, 0xF8, Status::Taken });                          // cmp rax, Taken
+    patches.emplace_back(EmitJump({ 0x0F, 0x84 }), position + offset);  // je target
+    Emit({ 0x48, 0x85, 0xC0 });                                         // test rax, rax
+    xword finished = EmitJump({ 0x0F, 0x84 });                          // jz next
+    EmitExit(position, true);
+    Bind(finished);
+    Bind(next);
+}
+
+void Jit::EmitAddConstant(xword position, long value)
+{
+    xword slow, carry[3], next;
+
+    // Fast path: a positive single digit top with no carry (borrow)
+    if (value >= -INT32_MAX && value <= INT32_MAX)
+    {
+        EmitTop(slow);
+        Emit({ 0x48, 0x83, 0x78, offsetof(Integer, width), 0x01 });     // cmp qword [rax + width], 1
+        carry[0] = EmitJump({ 0x0F, 0x85 });                            // jne slow
+        Emit({ 0x80, 0x78, offsetof(Integer, sign), 0x00 });            // cmp byte [rax + sign], 0
+        carry[1] = EmitJump({ 0x0F, 0x85 });                            // jne slow
+        Emit({ 0x48, 0x8B, 0x48, offsetof(Integer, magnitude) });       // mov rcx, [rax + magnitude]
+        Emit({ 0x48, 0x8B, 0x11 });                                     // mov rdx, [rcx]
+        if (value >= 0)
+            Emit({ 0x48, 0x81, 0xC2 });                                 // add rdx, value
+        else
+            Emit({ 0x48, 0x81, 0xEA });                                 // sub rdx, -value
+        Emit32(value >= 0 ? value : -value);
+        carry[2] = EmitJump({ 0x0F, 0x82 });                            // jc slow
+        Emit({ 0x48, 0x89, 0x11 });                                     // mov [rcx], rdx
+        next = EmitJump({ 0xE9 });                                      // jmp next
+
+        Bind(slow);
+        for (xword location : carry)
+            Bind(location);
+        EmitCall(AddConstantHelper, value, position);
+        Bind(next);
+    }
+    else
+    {
+        EmitCall(AddConstantHelper, value, position);
+    }
+}
+
+void Jit::Translate(const byte* opcodes, const long* offsets, const long* operands, const Loop* loops,
+                    xword count)
+{
+    Emit({ 0x53 });                                                     // push rbx (aligns the stack)
+    for (xword position = 0; position < count; ++position)
+    {
+        addresses[position] = length;
+        switch (opcodes[position])
+        {
+            case Opcode::Halt:         EmitCall(Call<Instruction::HaltOperations>, 0, position); break;
+            case Opcode::Nop:          break;
+            case Opcode::Input:        EmitCall(Call<Instruction::InputOperations>, 0, position); break;
+            case Opcode::RotUnchecked:
+            case Opcode::Rot:          EmitCall(Call<Instruction::RotOperations>, 0, position); break;
+            case Opcode::SwapUnchecked:
+            case Opcode::Swap:         EmitCall(Call<Instruction::SwapOperations>, 0, position); break;
+            case Opcode::Push:         EmitCall(Call<Instruction::PushOperations>, 0, position); break;
+            case Opcode::RRotUnchecked:
+            case Opcode::RRot:         EmitCall(Call<Instruction::RRotOperations>, 0, position); break;
+            case Opcode::DupUnchecked:
+            case Opcode::Dup:          EmitCall(Call<Instruction::DupOperations>, 0, position); break;
+            case Opcode::AddUnchecked:
+            case Opcode::Add:          EmitCall(Call<Instruction::AddOperations>, 0, position); break;
+            case Opcode::LbraceUnchecked:
+            case Opcode::Lbrace:       EmitLbrace(position, offsets[position]); break;
+            case Opcode::Output:       EmitCall(Call<Instruction::OutputOperations>, 0, position); break;
+            case Opcode::MultiplyUnchecked:
+            case Opcode::Multiply:     EmitCall(Call<Instruction::MultiplyOperations>, 0, position); break;
+            case Opcode::Execute:      EmitCall(Call<Instruction::ExecuteOperations>, 0, position); break;
+            case Opcode::NegateUnchecked:
+            case Opcode::Negate:       EmitCall(Call<Instruction::NegateOperations>, 0, position); break;
+            case Opcode::PopUnchecked:
+            case Opcode::Pop:          EmitCall(Call<Instruction::PopOperations>, 0, position); break;
+            case Opcode::PushConstant: EmitCall(PushConstantHelper, operands[position], position); break;
+            case Opcode::AddConstant:  EmitAddConstant(position, operands[position]); break;
+            case Opcode::Square:       EmitCall(SquareHelper, 0, position); break;
+            case Opcode::Double:       EmitCall(DoubleHelper, 0, position); break;
+            case Opcode::Rotate:       EmitCall(RotateHelper, operands[position], position); break;
+            case Opcode::CountedLoop:  EmitCall(LoopHelper, (long) (loops + operands[position]), position); break;
+            case Opcode::Rbrace:
+                patches.emplace_back(EmitJump({ 0xE9 }), position + offsets[position]);
+                break;
+            case Opcode::End:
+                EmitExit(position, false);
+                break;
+        }
+    }
+
+    for (const std::pair<xword, xword>& patch : patches)
+    {
+        std::uint32_t displacement = addresses[patch.second] - (patch.first + 4);
+        memcpy(code + patch.first, &displacement, sizeof(displacement));
+    }
+}
+
+/// @}
+
+/// @ingroup Constructors & Destructor
+/// @{
+
+/**
+ * @brief Translates count opcodes (the last one being End) to native code;
+ *      the jit is not compiled if the memory mapping fails
+ */
+Jit::Jit(const byte* opcodes, const long* offsets, const long* operands, const Loop* loops, xword count) :
+    code(nullptr), size(0), length(0), addresses(count)
+{
+    xword pageSize = sysconf(_SC_PAGESIZE);
+
+    size = ((count + 1) * maxOpcodeSize + pageSize - 1) / pageSize * pageSize;
+    void* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED)
+        return;
+
+    code = (byte*) memory;
+    Translate(opcodes, offsets, operands, loops, count);
+    if (mprotect(code, size, PROT_READ | PROT_EXEC))
+    {
+        munmap(code, size);
+        code = nullptr;
+    }
+}
+
+Jit::~Jit()
+{
+    if (code)
+        munmap(code, size);
+}
+
+/// @}
+
+/// @ingroup Methods
+/// @{
+
+INLINE bool Jit::Compiled() const
+{
+    return code != nullptr;
+}
+
+// Runs the native code, returning (position << 2) | status
+INLINE xword Jit::operator () () const
+{
+    return ((Function<xword>) code)();
+}
+
+/// @}
+
+#endif  // __x86_64__ && __unix__
+
+#endif  // JIT_HPP
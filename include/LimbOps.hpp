@@ -0,0 +1,828 @@
+/// ============================
+/// @author Andrei Biu - Pislaru
+/// @brief Implementation of LimbOps "static" class
+/// ============================
+
+#ifndef LIMB_OPS_HPP
+#define LIMB_OPS_HPP
+
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <type_traits>
+
+#include "ArithmeticOps.hpp"
+#include "Ntt.hpp"
+#include "Parallel.hpp"
+
+#ifndef GLYPHO_KARATSUBA_THRESHOLD
+#define GLYPHO_KARATSUBA_THRESHOLD 20
+#endif
+
+#ifndef GLYPHO_TOOM3_THRESHOLD
+#define GLYPHO_TOOM3_THRESHOLD 200
+#endif
+
+#ifndef GLYPHO_NTT_THRESHOLD
+#define GLYPHO_NTT_THRESHOLD 12000
+#endif
+
+#ifndef GLYPHO_DIVIDE_THRESHOLD
+#define GLYPHO_DIVIDE_THRESHOLD 60
+#endif
+
+/**
+ * @class LimbOps
+ * @brief Contains the low-level algorithms that operate on raw arrays of
+ *        xword limbs (least significant limb first) used by the Integer class
+ * @details Multiplication is done by choosing, based on the width of the
+ *          operands, between schoolbook, Karatsuba, Toom-3 and NTT (if the
+ *          compiler supports 128-bit integers); the widths where the faster
+ *          algorithms take over are tunable at compile time
+ *          (GLYPHO_*_THRESHOLD macros) and at run time (setters); every tier
+ *          has a squaring variant, selected when both operands are the
+ *          same array; the independent sub-products of the wide products
+ *          (Karatsuba, Toom-3 and the NTT primes) run in parallel (see the
+ *          Parallel class); division uses the schoolbook algorithm (Knuth D)
+ *          and switches to the recursive Burnikel - Ziegler algorithm for
+ *          wide divisors
+ * @note All members are static to simplify the singleton pattern
+ */
+class LimbOps
+{
+    /// @defgroup Static Fields
+    private:
+        static xword karatsubaThreshold;
+        static xword toom3Threshold;
+        static xword nttThreshold;
+        static xword divideThreshold;
+
+    /// @defgroup Static Getters & Setters
+    public:
+        static xword KaratsubaThreshold();
+        static void KaratsubaThreshold(xword threshold);
+        static xword Toom3Threshold();
+        static void Toom3Threshold(xword threshold);
+        static xword NttThreshold();
+        static void NttThreshold(xword threshold);
+        static xword DivideThreshold();
+        static void DivideThreshold(xword threshold);
+
+    /// @defgroup Private Static Methods
+    private:
+        static int Compare(const xword* left, const xword* right, xword width);
+        static void Negate(xword* limbs, xword width);
+        static void ShiftRight1(xword* limbs, xword width);
+        static void DivideExactBy3(xword* limbs, xword width);
+        static bool SubtractAbs(xword* result, const xword* left, xword leftWidth,
+                                const xword* right, xword rightWidth);
+        static void MultiplyBasecase(xword* result, const xword* left, xword leftWidth,
+                                     const xword* right, xword rightWidth);
+        static void SquareBasecase(xword* result, const xword* limbs, xword width);
+        static void MultiplyBalanced(xword* result, const xword* left, const xword* right, xword width);
+        static void MultiplyKaratsuba(xword* result, const xword* left, const xword* right, xword width);
+        static void MultiplyToom3(xword* result, const xword* left, const xword* right, xword width);
+        static xword Decrement(xword* limbs, xword width);
+        static xword SubtractMultiply(xword* result, const xword* left, xword width, xword value);
+        static xword DivideBasecase(xword* quotient, xword* numerator, xword width,
+                                    const xword* divisor, xword divisorWidth);
+        static xword DivideRecursive(xword* quotient, xword* numerator, const xword* divisor,
+                                     xword divisorWidth, xword quotientWidth);
+
+    /// @defgroup Public Static Methods
+    public:
+        static xword Add(xword* result, const xword* left, xword leftWidth,
+                         const xword* right, xword rightWidth);
+        static xword Subtract(xword* result, const xword* left, xword leftWidth,
+                              const xword* right, xword rightWidth);
+        static xword AddInPlace(xword* result, xword resultWidth, const xword* value, xword width);
+        static xword SubtractInPlace(xword* result, xword resultWidth, const xword* value, xword width);
+        static xword Multiply(xword* result, const xword* left, xword width, xword value);
+        static xword AddMultiply(xword* result, const xword* left, xword width, xword value);
+        static void Multiply(xword* result, const xword* left, xword leftWidth,
+                             const xword* right, xword rightWidth);
+        static void Square(xword* result, const xword* limbs, xword width);
+        static xword ShiftLeft(xword* result, const xword* limbs, xword width, xword shift);
+        static void ShiftRight(xword* result, const xword* limbs, xword width, xword shift);
+        static xword Divide(xword* quotient, const xword* limbs, xword width, xword divisor);
+        static void Divide(xword* quotient, xword* remainder, const xword* numerator, xword width,
+                           const xword* divisor, xword divisorWidth);
+};
+
+
+/// @ingroup Static Fields
+/// @{
+inline xword LimbOps::karatsubaThreshold = GLYPHO_KARATSUBA_THRESHOLD;
+inline xword LimbOps::toom3Threshold = GLYPHO_TOOM3_THRESHOLD;
+inline xword LimbOps::nttThreshold = GLYPHO_NTT_THRESHOLD;
+inline xword LimbOps::divideThreshold = GLYPHO_DIVIDE_THRESHOLD;
+/// @}
+
+/// @ingroup Static Getters & Setters
+/// @{
+INLINE xword LimbOps::KaratsubaThreshold() { return karatsubaThreshold; }
+INLINE void LimbOps::KaratsubaThreshold(xword threshold) { karatsubaThreshold = std::max<xword>(threshold, 4); }
+INLINE xword LimbOps::Toom3Threshold() { return toom3Threshold; }
+INLINE void LimbOps::Toom3Threshold(xword threshold) { toom3Threshold = std::max<xword>(threshold, 9); }
+INLINE xword LimbOps::NttThreshold() { return nttThreshold; }
+INLINE void LimbOps::NttThreshold(xword threshold) { nttThreshold = std::max<xword>(threshold, 2); }
+INLINE xword LimbOps::DivideThreshold() { return divideThreshold; }
+INLINE void LimbOps::DivideThreshold(xword threshold) { divideThreshold = std::max<xword>(threshold, 4); }
+/// @}
+
+/// @ingroup Private Static Methods
+/// @{
+
+INLINE int LimbOps::Compare(const xword* left, const xword* right, xword width)
+{
+    while (width--)
+        if (left[width] != right[width])
+            return left[width] > right[width] ? 1 : -1;
+    return 0;
+}
+
+// Two's complement negation modulo 2^(width * mbw)
+INLINE void LimbOps::Negate(xword* limbs, xword width)
+{
+    xword index = 0;
+
+    while (index < width && limbs[index] == 0)
+        ++index;
+    if (index < width)
+    {
+        limbs[index] = -limbs[index];
+        while (++index < width)
+            limbs[index] = ~limbs[index];
+    }
+}
+
+// Arithmetic (sign preserving) shift of a two's complement value
+INLINE void LimbOps::ShiftRight1(xword* limbs, xword width)
+{
+    constexpr xword topBit = sizeof(xword) * 8 - 1;
+
+    for (xword index = 0; index + 1 < width; ++index)
+        limbs[index] = (limbs[index] >> 1) | (limbs[index + 1] << topBit);
+    limbs[width - 1] = (xword) ((std::make_signed_t<xword>) limbs[width - 1] >> 1);
+}
+
+// Exact division by 3 modulo 2^(width * mbw) using the inverse of 3; the
+// result is the true quotient (also for two's complement values) only if
+// the value is a multiple of 3
+INLINE void LimbOps::DivideExactBy3(xword* limbs, xword width)
+{
+    constexpr xword inverse = (xword) 0xAAAAAAAAAAAAAAABull;
+    constexpr xword third = (xword) -1 / 3, twoThirds = third << 1;
+    xword borrow = 0;
+
+    for (xword index = 0; index < width; ++index)
+    {
+        xword value = limbs[index], difference = value - borrow;
+        borrow = difference > value;
+        limbs[index] = difference * inverse;
+        borrow += (limbs[index] > third) + (limbs[index] > twoThirds);
+    }
+}
+
+// Computes |left - right| into result (leftWidth limbs, leftWidth >= rightWidth)
+// and returns true if the difference is negative
+INLINE bool LimbOps::SubtractAbs(xword* result, const xword* left, xword leftWidth,
+                                 const xword* right, xword rightWidth)
+{
+    xword width = leftWidth;
+
+    while (width > rightWidth && left[width - 1] == 0)
+        --width;
+    if (width == rightWidth && Compare(left, right, width) < 0)
+    {
+        Subtract(result, right, width, left, width);
+        std::fill(result + width, result + leftWidth, 0);
+        return true;
+    }
+
+    Subtract(result, left, leftWidth, right, rightWidth);
+    return false;
+}
+
+void LimbOps::MultiplyBasecase(xword* result, const xword* left, xword leftWidth,
+                               const xword* right, xword rightWidth)
+{
+    result[leftWidth] = Multiply(result, left, leftWidth, right[0]);
+    for (xword index = 1; index < rightWidth; ++index)
+        result[leftWidth + index] = AddMultiply(result + index, left, leftWidth, right[index]);
+}
+
+// The off-diagonal products are computed once and doubled
+void LimbOps::SquareBasecase(xword* result, const xword* limbs, xword width)
+{
+    constexpr xword topBit = sizeof(xword) * 8 - 1;
+    xword carry = 0;
+
+    std::fill(result, result + (width << 1), 0);
+    for (xword index = 0; index + 1 < width; ++index)
+        result[index + width] = AddMultiply(result + (index << 1) + 1, limbs + index + 1,
+                                            width - index - 1, limbs[index]);
+
+    for (xword index = 0; index < (width << 1); ++index)
+    {
+        xword value = result[index];
+        result[index] = (value << 1) | carry;
+        carry = value >> topBit;
+    }
+
+    for (xword index = 0; index < width; ++index)
+    {
+        dxword square = ArithmeticOps::Multiply(limbs[index], limbs[index]);
+        xword* pair = result + (index << 1);
+        square.second += carry;
+        carry = square.second < carry;
+        pair[0] += square.second;
+        carry += pair[0] < square.second;
+        square.first += carry;
+        carry = square.first < carry;
+        pair[1] += square.first;
+        carry += pair[1] < square.first;
+    }
+}
+
+// Squaring is selected for all tiers when the operands are the same array
+void LimbOps::MultiplyBalanced(xword* result, const xword* left, const xword* right, xword width)
+{
+    if (width < karatsubaThreshold)
+    {
+        if (left == right)
+            SquareBasecase(result, left, width);
+        else
+            MultiplyBasecase(result, left, width, right, width);
+    }
+    else if (width < toom3Threshold)
+    {
+        MultiplyKaratsuba(result, left, right, width);
+    }
+#if defined(GLYPHO_NTT)
+    else if (width >= nttThreshold)
+    {
+        Ntt::Multiply(result, left, width, right, width);
+    }
+#endif
+    else
+    {
+        MultiplyToom3(result, left, right, width);
+    }
+}
+
+/**
+ * @brief Karatsuba multiplication of two operands of equal width; with
+ *      x = B^k, a = a0 + a1 x, b = b0 + b1 x, the middle coefficient is
+ *      a0 b0 + a1 b1 - (a0 - a1)(b0 - b1)
+ */
+void LimbOps::MultiplyKaratsuba(xword* result, const xword* left, const xword* right, xword width)
+{
+    xword low = (width + 1) >> 1, high = width - low;
+    xword* buffer = (xword*) malloc((low << 2) * sizeof(xword) + (low + 1) * 2 * sizeof(xword));
+    xword *leftDifference = buffer,
+          *rightDifference = buffer + low,
+          *middleProduct = buffer + (low << 1),
+          *middle = middleProduct + (low << 1);
+    bool sign;
+
+    sign = SubtractAbs(leftDifference, left, low, left + low, high);
+    if (left == right)
+    {
+        rightDifference = leftDifference;
+        sign = false;
+    }
+    else
+    {
+        sign ^= SubtractAbs(rightDifference, right, low, right + low, high);
+    }
+
+    Parallel::Invoke(width >= Parallel::Threshold(),
+        [&] { MultiplyBalanced(result, left, right, low); },
+        [&] { MultiplyBalanced(result + (low << 1), left + low, right + low, high); },
+        [&] { MultiplyBalanced(middleProduct, leftDifference, rightDifference, low); });
+
+    memcpy(middle, result, (low << 1) * sizeof(xword));
+    middle[low << 1] = AddInPlace(middle, low << 1, result + (low << 1), high << 1);
+    if (sign)
+        AddInPlace(middle, (low << 1) + 1, middleProduct, low << 1);
+    else
+        SubtractInPlace(middle, (low << 1) + 1, middleProduct, low << 1);
+    AddInPlace(result + low, (width << 1) - low, middle, std::min((low << 1) + 1, (width << 1) - low));
+
+    free(buffer);
+}
+
+/**
+ * @brief Toom-3 multiplication of two operands of equal width; the operands
+ *      are split in three parts, evaluated in 0, 1, -1, -2, inf and the
+ *      product polynomial is interpolated using Bodrato's sequence, with the
+ *      intermediate (possibly negative) values kept in two's complement
+ */
+void LimbOps::MultiplyToom3(xword* result, const xword* left, const xword* right, xword width)
+{
+    xword part = (width + 2) / 3, high = width - (part << 1),
+          evaluationWidth = part + 1, productWidth = (part << 1) + 2;
+    xword* buffer = (xword*) calloc(evaluationWidth * 8 + productWidth * 3, sizeof(xword));
+    xword *leftAt1 = buffer,
+          *leftAtMinus1 = leftAt1 + evaluationWidth,
+          *leftAtMinus2 = leftAtMinus1 + evaluationWidth,
+          *rightAt1 = leftAtMinus2 + evaluationWidth,
+          *rightAtMinus1 = rightAt1 + evaluationWidth,
+          *rightAtMinus2 = rightAtMinus1 + evaluationWidth,
+          *temp0 = rightAtMinus2 + evaluationWidth,
+          *temp1 = temp0 + evaluationWidth,
+          *productAt1 = temp1 + evaluationWidth,
+          *productAtMinus1 = productAt1 + productWidth,
+          *productAtMinus2 = productAtMinus1 + productWidth;
+    bool signAtMinus1, signAtMinus2;
+
+    auto evaluate = [&] (const xword* limbs, xword* at1, xword* atMinus1, xword* atMinus2) -> std::pair<bool, bool> {
+        const xword *part0 = limbs, *part1 = limbs + part, *part2 = limbs + (part << 1);
+        std::pair<bool, bool> signs;
+
+        // p(1) = p0 + p1 + p2, p(-1) = p0 - p1 + p2
+        temp0[part] = Add(temp0, part0, part, part2, high);
+        memcpy(at1, temp0, evaluationWidth * sizeof(xword));
+        AddInPlace(at1, evaluationWidth, part1, part);
+        signs.first = SubtractAbs(atMinus1, temp0, evaluationWidth, part1, part);
+
+        // p(-2) = p0 - 2 p1 + 4 p2
+        std::fill(temp1, temp1 + evaluationWidth, 0);
+        temp1[high] = Multiply(temp1, part2, high, 4);
+        AddInPlace(temp1, evaluationWidth, part0, part);
+        temp0[part] = Multiply(temp0, part1, part, 2);
+        signs.second = SubtractAbs(atMinus2, temp1, evaluationWidth, temp0, evaluationWidth);
+
+        return signs;
+    };
+
+    std::pair<bool, bool> leftSigns = evaluate(left, leftAt1, leftAtMinus1, leftAtMinus2), rightSigns;
+    if (left == right)
+    {
+        rightAt1 = leftAt1;
+        rightAtMinus1 = leftAtMinus1;
+        rightAtMinus2 = leftAtMinus2;
+        rightSigns = leftSigns;
+    }
+    else
+    {
+        rightSigns = evaluate(right, rightAt1, rightAtMinus1, rightAtMinus2);
+    }
+    signAtMinus1 = leftSigns.first != rightSigns.first;
+    signAtMinus2 = leftSigns.second != rightSigns.second;
+
+    // Pointwise products
+    Parallel::Invoke(width >= Parallel::Threshold(),
+        [&] { MultiplyBalanced(result, left, right, part); },
+        [&] {
+            std::fill(result + (part << 1), result + (part << 2), 0);
+            MultiplyBalanced(result + (part << 2), left + (part << 1), right + (part << 1), high);
+        },
+        [&] { MultiplyBalanced(productAt1, leftAt1, rightAt1, evaluationWidth); },
+        [&] {
+            MultiplyBalanced(productAtMinus1, leftAtMinus1, rightAtMinus1, evaluationWidth);
+            if (signAtMinus1)
+                Negate(productAtMinus1, productWidth);
+        },
+        [&] {
+            MultiplyBalanced(productAtMinus2, leftAtMinus2, rightAtMinus2, evaluationWidth);
+            if (signAtMinus2)
+                Negate(productAtMinus2, productWidth);
+        });
+
+    // Interpolation (r0 and r4 are already in place inside the result)
+    const xword *r0 = result, *r4 = result + (part << 2);
+    xword *r1 = productAt1, *r2 = productAtMinus1, *r3 = productAtMinus2;
+
+    SubtractInPlace(r3, productWidth, r1, productWidth);      // r3 = (r(-2) - r(1)) / 3
+    DivideExactBy3(r3, productWidth);
+    SubtractInPlace(r1, productWidth, r2, productWidth);      // r1 = (r(1) - r(-1)) / 2
+    ShiftRight1(r1, productWidth);
+    SubtractInPlace(r2, productWidth, r0, part << 1);         // r2 = r(-1) - r(0)
+    Negate(r3, productWidth);                                 // r3 = (r2 - r3) / 2 + 2 r(inf)
+    AddInPlace(r3, productWidth, r2, productWidth);
+    ShiftRight1(r3, productWidth);
+    AddInPlace(r3, productWidth, r4, high << 1);
+    AddInPlace(r3, productWidth, r4, high << 1);
+    AddInPlace(r2, productWidth, r1, productWidth);           // r2 = r2 + r1 - r(inf)
+    SubtractInPlace(r2, productWidth, r4, high << 1);
+    SubtractInPlace(r1, productWidth, r3, productWidth);      // r1 = r1 - r3
+
+    // Recomposition
+    xword resultWidth = width << 1;
+    AddInPlace(result + part, resultWidth - part, r1, std::min(productWidth, resultWidth - part));
+    AddInPlace(result + (part << 1), resultWidth - (part << 1), r2, std::min(productWidth, resultWidth - (part << 1)));
+    AddInPlace(result + part * 3, resultWidth - part * 3, r3, std::min(productWidth, resultWidth - part * 3));
+
+    free(buffer);
+}
+
+/// @brief Subtracts one from a limb array and returns the final borrow
+INLINE xword LimbOps::Decrement(xword* limbs, xword width)
+{
+    xword index = 0;
+
+    while (index < width && limbs[index]-- == 0)
+        ++index;
+
+    return index == width;
+}
+
+/// @brief Subtracts the product of a limb array with a single limb from result and returns the borrow limb
+INLINE xword LimbOps::SubtractMultiply(xword* result, const xword* left, xword width, xword value)
+{
+    dxword temp;
+    xword carry = 0;
+
+    for (xword index = 0; index < width; ++index)
+    {
+        temp = ArithmeticOps::Multiply(left[index], value);
+        temp.second += carry;
+        carry = temp.first + (temp.second < carry);
+        xword previous = result[index];
+        result[index] = previous - temp.second;
+        carry += result[index] > previous;
+    }
+
+    return carry;
+}
+
+/**
+ * @brief Schoolbook division (Knuth's algorithm D) of a numerator of width
+ *      limbs by a normalized divisor (most significant bit set); the
+ *      quotient (width - divisorWidth limbs) is stored in quotient, the
+ *      remainder replaces the low limbs of the numerator and the most
+ *      significant limb of the quotient (0 or 1) is returned
+ */
+xword LimbOps::DivideBasecase(xword* quotient, xword* numerator, xword width,
+                              const xword* divisor, xword divisorWidth)
+{
+    xword count = width - divisorWidth,
+          top = divisor[divisorWidth - 1],
+          next = divisor[divisorWidth - 2];
+    xword high = Compare(numerator + count, divisor, divisorWidth) >= 0;
+
+    if (high)
+        Subtract(numerator + count, numerator + count, divisorWidth, divisor, divisorWidth);
+
+    for (xword index = count; index--; )
+    {
+        xword* window = numerator + index;
+        xword estimate = (xword) -1;
+
+        // Estimate the quotient digit from the top limbs and refine it using
+        // the second limb of the divisor (off by at most one afterwards)
+        if (window[divisorWidth] < top)
+        {
+            dxword division = ArithmeticOps::Divide(window[divisorWidth], window[divisorWidth - 1], top);
+            xword remainder = division.second;
+
+            estimate = division.first;
+            while (true)
+            {
+                dxword product = ArithmeticOps::Multiply(estimate, next);
+                if (product.first < remainder ||
+                    (product.first == remainder && product.second <= window[divisorWidth - 2]))
+                    break;
+                --estimate;
+                remainder += top;
+                if (remainder < top)
+                    break;
+            }
+        }
+
+        window[divisorWidth] -= SubtractMultiply(window, divisor, divisorWidth, estimate);
+        while (window[divisorWidth])
+        {
+            --estimate;
+            window[divisorWidth] += AddInPlace(window, divisorWidth, divisor, divisorWidth);
+        }
+        quotient[index] = estimate;
+    }
+
+    return high;
+}
+
+/**
+ * @brief Recursive division (Burnikel - Ziegler, as in Brent & Zimmermann's
+ *      RecursiveDivRem) of a numerator of divisorWidth + quotientWidth limbs
+ *      by a normalized divisor (quotientWidth <= divisorWidth); the outputs
+ *      are the same as the ones of the basecase division
+ */
+xword LimbOps::DivideRecursive(xword* quotient, xword* numerator, const xword* divisor,
+                               xword divisorWidth, xword quotientWidth)
+{
+    if (quotientWidth < divideThreshold)
+        return DivideBasecase(quotient, numerator, divisorWidth + quotientWidth, divisor, divisorWidth);
+
+    xword low = quotientWidth >> 1, high, middle, borrow;
+    xword* product = (xword*) malloc(quotientWidth * sizeof(xword));
+
+    // Upper half of the quotient, then A' = A - Q1 * B0 * B^k
+    high = DivideRecursive(quotient + low, numerator + (low << 1), divisor + low,
+                           divisorWidth - low, quotientWidth - low);
+    Multiply(product, quotient + low, quotientWidth - low, divisor, low);
+    borrow = SubtractInPlace(numerator + low, divisorWidth, product, quotientWidth);
+    if (high)
+        borrow += SubtractInPlace(numerator + quotientWidth, divisorWidth + low - quotientWidth, divisor, low);
+    while (borrow)
+    {
+        high -= Decrement(quotient + low, quotientWidth - low);
+        borrow -= AddInPlace(numerator + low, divisorWidth, divisor, divisorWidth);
+    }
+
+    // Lower half of the quotient, then A'' = A' - Q0 * B0
+    middle = DivideRecursive(quotient, numerator + low, divisor + low, divisorWidth - low, low);
+    Multiply(product, quotient, low, divisor, low);
+    borrow = SubtractInPlace(numerator, divisorWidth, product, low << 1);
+    if (middle)
+        borrow += SubtractInPlace(numerator + low, divisorWidth - low, divisor, low);
+    high += AddInPlace(quotient + low, quotientWidth - low, &middle, 1);
+    while (borrow)
+    {
+        high -= Decrement(quotient, quotientWidth);
+        borrow -= AddInPlace(numerator, divisorWidth, divisor, divisorWidth);
+    }
+
+    free(product);
+    return high;
+}
+
+/// @}
+
+/// @ingroup Public Static Methods
+/// @{
+
+/**
+ * @brief Adds two limb arrays (leftWidth >= rightWidth) into result
+ *      (leftWidth limbs) and returns the final carry
+ */
+INLINE xword LimbOps::Add(xword* result, const xword* left, xword leftWidth,
+                          const xword* right, xword rightWidth)
+{
+    xword carry = 0, index = 0;
+
+    while (index < rightWidth)
+    {
+        xword sum = left[index] + carry;
+        carry = sum < carry;
+        result[index] = sum + right[index];
+        carry += result[index] < sum;
+        ++index;
+    }
+    while (index < leftWidth)
+    {
+        result[index] = left[index] + carry;
+        carry = result[index] < carry;
+        ++index;
+    }
+
+    return carry;
+}
+
+/**
+ * @brief Subtracts two limb arrays (leftWidth >= rightWidth) into result
+ *      (leftWidth limbs) and returns the final borrow
+ */
+INLINE xword LimbOps::Subtract(xword* result, const xword* left, xword leftWidth,
+                               const xword* right, xword rightWidth)
+{
+    xword borrow = 0, index = 0;
+
+    while (index < rightWidth)
+    {
+        xword difference = left[index] - right[index];
+        xword nextBorrow = difference > left[index];
+        result[index] = difference - borrow;
+        borrow = nextBorrow + (result[index] > difference);
+        ++index;
+    }
+    while (index < leftWidth)
+    {
+        result[index] = left[index] - borrow;
+        borrow = result[index] > left[index];
+        ++index;
+    }
+
+    return borrow;
+}
+
+/// @brief Adds a value (width <= resultWidth) to result and returns the final carry
+INLINE xword LimbOps::AddInPlace(xword* result, xword resultWidth, const xword* value, xword width)
+{
+    xword carry = 0, index = 0;
+
+    while (index < width)
+    {
+        xword sum = value[index] + carry;
+        carry = sum < carry;
+        result[index] += sum;
+        carry += result[index] < sum;
+        ++index;
+    }
+    while (carry && index < resultWidth)
+        carry = ++result[index++] == 0;
+
+    return carry;
+}
+
+/// @brief Subtracts a value (width <= resultWidth) from result and returns the final borrow
+INLINE xword LimbOps::SubtractInPlace(xword* result, xword resultWidth, const xword* value, xword width)
+{
+    xword borrow = 0, index = 0;
+
+    while (index < width)
+    {
+        xword subtrahend = value[index] + borrow;
+        borrow = subtrahend < borrow;
+        borrow += result[index] < subtrahend;
+        result[index] -= subtrahend;
+        ++index;
+    }
+    while (borrow && index < resultWidth)
+        borrow = result[index++]-- == 0;
+
+    return borrow;
+}
+
+/// @brief Multiplies a limb array with a single limb and returns the carry limb
+INLINE xword LimbOps::Multiply(xword* result, const xword* left, xword width, xword value)
+{
+    dxword temp;
+    xword carry = 0;
+
+    for (xword index = 0; index < width; ++index)
+    {
+        temp = ArithmeticOps::Multiply(left[index], value);
+        result[index] = temp.second + carry;
+        carry = temp.first + (result[index] < carry);
+    }
+
+    return carry;
+}
+
+/// @brief Adds the product of a limb array with a single limb to result and returns the carry limb
+INLINE xword LimbOps::AddMultiply(xword* result, const xword* left, xword width, xword value)
+{
+    dxword temp;
+    xword carry = 0;
+
+    for (xword index = 0; index < width; ++index)
+    {
+        temp = ArithmeticOps::Multiply(left[index], value);
+        temp.second += carry;
+        carry = temp.first + (temp.second < carry);
+        result[index] += temp.second;
+        carry += result[index] < temp.second;
+    }
+
+    return carry;
+}
+
+/**
+ * @brief Multiplies two limb arrays (leftWidth >= rightWidth) into result
+ *      (leftWidth + rightWidth limbs); unbalanced operands are processed
+ *      as a sequence of balanced products of rightWidth limbs
+ */
+void LimbOps::Multiply(xword* result, const xword* left, xword leftWidth,
+                       const xword* right, xword rightWidth)
+{
+    if (rightWidth < karatsubaThreshold)
+    {
+        MultiplyBasecase(result, left, leftWidth, right, rightWidth);
+    }
+#if defined(GLYPHO_NTT)
+    else if (rightWidth >= nttThreshold)
+    {
+        Ntt::Multiply(result, left, leftWidth, right, rightWidth);
+    }
+#endif
+    else if (leftWidth == rightWidth)
+    {
+        MultiplyBalanced(result, left, right, rightWidth);
+    }
+    else
+    {
+        xword offset = 0, resultWidth = leftWidth + rightWidth;
+        xword* product = (xword*) malloc((rightWidth << 1) * sizeof(xword));
+
+        std::fill(result, result + resultWidth, 0);
+        while (offset < leftWidth)
+        {
+            xword chunk = std::min(rightWidth, leftWidth - offset);
+            if (chunk == rightWidth)
+                MultiplyBalanced(product, left + offset, right, rightWidth);
+            else
+                Multiply(product, right, rightWidth, left + offset, chunk);
+            AddInPlace(result + offset, resultWidth - offset, product, rightWidth + chunk);
+            offset += chunk;
+        }
+
+        free(product);
+    }
+}
+
+/// @brief Squares a limb array into result (2 * width limbs)
+INLINE void LimbOps::Square(xword* result, const xword* limbs, xword width)
+{
+    MultiplyBalanced(result, limbs, limbs, width);
+}
+
+/// @brief Shifts a limb array to the left (shift < mbw) and returns the bits shifted out
+INLINE xword LimbOps::ShiftLeft(xword* result, const xword* limbs, xword width, xword shift)
+{
+    constexpr xword bits = sizeof(xword) * 8;
+    xword carry = 0;
+
+    if (shift == 0)
+    {
+        memmove(result, limbs, width * sizeof(xword));
+        return 0;
+    }
+    for (xword index = 0; index < width; ++index)
+    {
+        xword value = limbs[index];
+        result[index] = (value << shift) | carry;
+        carry = value >> (bits - shift);
+    }
+
+    return carry;
+}
+
+/// @brief Shifts a limb array to the right (shift < mbw)
+INLINE void LimbOps::ShiftRight(xword* result, const xword* limbs, xword width, xword shift)
+{
+    constexpr xword bits = sizeof(xword) * 8;
+
+    if (shift == 0)
+    {
+        memmove(result, limbs, width * sizeof(xword));
+        return;
+    }
+    for (xword index = 0; index + 1 < width; ++index)
+        result[index] = (limbs[index] >> shift) | (limbs[index + 1] << (bits - shift));
+    result[width - 1] = limbs[width - 1] >> shift;
+}
+
+/// @brief Divides a limb array by a single limb into quotient (width limbs) and returns the remainder
+INLINE xword LimbOps::Divide(xword* quotient, const xword* limbs, xword width, xword divisor)
+{
+    dxword division = std::make_pair(0, 0);
+
+    while (width--)
+    {
+        division = ArithmeticOps::Divide(division.second, limbs[width], divisor);
+        quotient[width] = division.first;
+    }
+
+    return division.second;
+}
+
+/**
+ * @brief Divides two limb arrays (width >= divisorWidth, the most significant
+ *      limb of the divisor being non-zero); the quotient has
+ *      width - divisorWidth + 1 limbs and the remainder divisorWidth limbs
+ */
+void LimbOps::Divide(xword* quotient, xword* remainder, const xword* numerator, xword width,
+                     const xword* divisor, xword divisorWidth)
+{
+    if (divisorWidth == 1)
+    {
+        remainder[0] = Divide(quotient, numerator, width, divisor[0]);
+        return;
+    }
+
+    xword shift = sizeof(xword) * 8 - 1 - ArithmeticOps::Log2Floor(divisor[divisorWidth - 1]),
+          count = width + 1 - divisorWidth;
+    xword* buffer = (xword*) malloc((width + 1 + divisorWidth) * sizeof(xword));
+    xword *normalizedNumerator = buffer, *normalizedDivisor = buffer + width + 1;
+
+    ShiftLeft(normalizedDivisor, divisor, divisorWidth, shift);
+    normalizedNumerator[width] = ShiftLeft(normalizedNumerator, numerator, width, shift);
+
+    if (divisorWidth < divideThreshold)
+    {
+        DivideBasecase(quotient, normalizedNumerator, width + 1, normalizedDivisor, divisorWidth);
+    }
+    else
+    {
+        // The quotient is computed in blocks of at most divisorWidth limbs,
+        // starting with the most significant one
+        xword position = count, block = count % divisorWidth ? count % divisorWidth : divisorWidth;
+        while (position)
+        {
+            position -= block;
+            DivideRecursive(quotient + position, normalizedNumerator + position,
+                            normalizedDivisor, divisorWidth, block);
+            block = divisorWidth;
+        }
+    }
+    ShiftRight(remainder, normalizedNumerator, divisorWidth, shift);
+
+    free(buffer);
+}
+
+/// @}
+
+#endif  // LIMB_OPS_HPP
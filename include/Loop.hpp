@@ -0,0 +1,353 @@
+/// ============================
+/// @author Andrei Biu - Pislaru
+/// @brief Implementation for the closed form of counted loops
+/// ============================
+
+#ifndef LOOP_HPP
+#define LOOP_HPP
+
+#include <array>
+#include <cstdlib>
+#include <vector>
+#include "Integer.hpp"
+#include "Memory.hpp"
+#include "Opcode.hpp"
+
+/**
+ * @class Loop
+ * @brief Models a loop without nested braces whose body is an affine
+ *        transformation of the values near the ends of the memory, counted
+ *        by the value at the top (stepping by 1 towards zero); such a loop
+ *        runs in closed form, as a single bulk operation
+ * @details The body is executed symbolically on affine forms of the values
+ *          it reaches: the ones at the top of the memory (s0 being the
+ *          counter) and, through rotations, the ones at the bottom. A loop
+ *          is accepted when its body leaves as many values at each end as
+ *          it has taken, s0 becomes s0 + step (step = -1 or 1) and every
+ *          other value either stays the same (an invariant), is increased
+ *          or replaced by a combination of invariants, constants and the
+ *          counter. After n = -s0 / step iterations the increases sum to
+ *          n * L + k * (sum of the counters) and the replacements take the
+ *          value of the last iteration (with the counter equal to -step).
+ *          The memory must hold the values at both ends separately (so that
+ *          no operation of the body can fail) and the counter must reach
+ *          zero, otherwise the loop has to be run normally
+ */
+class Loop
+{
+    /// @defgroup Static Fields
+    private:
+        static constexpr xword maxDepth = 8;                   // values taken at each end
+        static constexpr xword variableCount = 1 + 2 * maxDepth;
+        static constexpr long maxCoefficient = 1L << 32;
+
+    /// @defgroup Nested Types
+    private:
+        // The coefficients of the constant 1, of the values at the top
+        // (s0 ... s7) and of the values at the bottom (b0 ... b7)
+        using Form = std::array<long, variableCount>;
+
+        enum class Kind : byte
+        {
+            Accumulate,     // increased by the form
+            Replace         // replaced by the form
+        };
+
+        struct Update
+        {
+            Kind kind;
+            xword variable;
+            Form form;
+        };
+
+    /// @defgroup Fields
+    private:
+        xword top;
+        xword bottom;
+        long step;
+        std::vector<Update> updates;
+
+    /// @defgroup Private Static Methods
+    private:
+        static Form Variable(xword variable);
+        static bool IsConstant(const Form& form);
+        static bool IsBounded(const Form& form);
+
+    /// @defgroup Private Methods
+    private:
+        Integer& Value(xword variable) const;
+        Integer Evaluate(const Form& form) const;
+
+    /// @defgroup Public Static Methods
+    public:
+        static bool Analyze(const byte* code, xword begin, xword end, Loop& loop);
+
+    /// @defgroup Methods
+    public:
+        bool Run() const;
+};
+
+
+/// @ingroup Private Static Methods
+/// @{
+
+INLINE Loop::Form Loop::Variable(xword variable)
+{
+    Form form {};
+    form[variable] = 1;
+    return form;
+}
+
+INLINE bool Loop::IsConstant(const Form& form)
+{
+    for (xword variable = 1; variable < variableCount; ++variable)
+        if (form[variable])
+            return false;
+    return true;
+}
+
+INLINE bool Loop::IsBounded(const Form& form)
+{
+    for (long coefficient : form)
+        if (coefficient > maxCoefficient || coefficient < -maxCoefficient)
+            return false;
+    return true;
+}
+
+/// @}
+
+/// @ingroup Private Methods
+/// @{
+
+// Returns the memory value of a variable (s_i or b_j)
+INLINE Integer& Loop::Value(xword variable) const
+{
+    return variable <= maxDepth ? Memory::At(variable - 1)
+                                : Memory::At(Memory::Size() - 1 - (variable - 1 - maxDepth));
+}
+
+// Evaluates a form without its counter (s0) term
+Integer Loop::Evaluate(const Form& form) const
+{
+    Integer result(std::labs(form[0]), form[0] < 0);
+
+    for (xword variable = 2; variable < variableCount; ++variable)
+        if (form[variable])
+        {
+            Integer term(std::labs(form[variable]), form[variable] < 0);
+            term *= Value(variable);
+            result += term;
+        }
+
+    return result;
+}
+
+/// @}
+
+/// @ingroup Public Static Methods
+/// @{
+
+/**
+ * @brief Analyzes the loop between the braces at begin and end of an
+ *      unoptimized code; returns whether it can run in closed form (the
+ *      model being stored in loop)
+ */
+bool Loop::Analyze(const byte* code, xword begin, xword end, Loop& loop)
+{
+    std::vector<Form> tops, bottoms;        // the last ones are the top & the bottom
+    xword top = 0, bottom = 0;
+
+    // Makes sure that count values are known at the top, taking the values
+    // below them from the memory
+    auto ensure = [&] (xword count) {
+        while (tops.size() < count)
+        {
+            if (top == maxDepth)
+                return false;
+            tops.insert(tops.begin(), Variable(1 + top++));
+        }
+        return true;
+    };
+
+    for (xword index = begin + 1; index < end; ++index)
+    {
+        Form value;
+
+        switch (code[index])
+        {
+            case Opcode::Nop:
+                break;
+            case Opcode::Push:
+                tops.push_back(Variable(0));
+                break;
+            case Opcode::Pop:
+                if (!ensure(1))
+                    return false;
+                tops.pop_back();
+                break;
+            case Opcode::Dup:
+                if (!ensure(1))
+                    return false;
+                tops.push_back(tops.back());
+                break;
+            case Opcode::Swap:
+                if (!ensure(2))
+                    return false;
+                std::swap(tops[tops.size() - 1], tops[tops.size() - 2]);
+                break;
+            case Opcode::Negate:
+                if (!ensure(1))
+                    return false;
+                for (long& coefficient : tops.back())
+                    coefficient = -coefficient;
+                break;
+            case Opcode::Add:
+                if (!ensure(2))
+                    return false;
+                value = tops.back();
+                tops.pop_back();
+                for (xword variable = 0; variable < variableCount; ++variable)
+                    tops.back()[variable] += value[variable];
+                break;
+            case Opcode::Multiply:
+                if (!ensure(2))
+                    return false;
+                value = tops.back();
+                tops.pop_back();
+                if (!IsConstant(value))
+                    std::swap(value, tops.back());
+                if (!IsConstant(value))
+                    return false;
+                for (long& coefficient : tops.back())
+                    if (__builtin_mul_overflow(coefficient, value[0], &coefficient))
+                        return false;
+                break;
+            case Opcode::Rot:
+                if (!ensure(1))
+                    return false;
+                bottoms.push_back(tops.back());
+                tops.pop_back();
+                break;
+            case Opcode::RRot:
+                if (bottoms.empty())
+                {
+                    if (bottom == maxDepth)
+                        return false;
+                    bottoms.push_back(Variable(1 + maxDepth + bottom++));
+                }
+                tops.push_back(bottoms.back());
+                bottoms.pop_back();
+                break;
+            default:
+                return false;
+        }
+
+        if ((!tops.empty() && !IsBounded(tops.back())) || (!bottoms.empty() && !IsBounded(bottoms.back())))
+            return false;
+    }
+
+    // The body must keep the shape of the memory and step the counter
+    if (tops.size() != top || bottoms.size() != bottom || top == 0)
+        return false;
+
+    Form counter = tops.back();
+    counter[0] = 0;
+    if (counter != Variable(1) || (tops.back()[0] != 1 && tops.back()[0] != -1))
+        return false;
+
+    // The invariants (the counter changes in a known way)
+    std::array<bool, variableCount> known {};
+    known[0] = known[1] = true;
+    for (xword index = 1; index < top; ++index)
+        known[1 + index] = tops[top - 1 - index] == Variable(1 + index);
+    for (xword index = 0; index < bottom; ++index)
+        known[1 + maxDepth + index] = bottoms[bottom - 1 - index] == Variable(1 + maxDepth + index);
+
+    loop.top = top;
+    loop.bottom = bottom;
+    loop.step = tops.back()[0];
+    loop.updates.clear();
+
+    auto update = [&] (xword variable, Form form) {
+        if (form == Variable(variable))
+            return true;
+
+        Kind kind = form[variable] == 1 ? Kind::Accumulate : Kind::Replace;
+        form[variable] -= kind == Kind::Accumulate;
+        for (xword other = 0; other < variableCount; ++other)
+            if (form[other] && !known[other])
+                return false;
+
+        loop.updates.push_back({ kind, variable, form });
+        return true;
+    };
+
+    for (xword index = 1; index < top; ++index)
+        if (!update(1 + index, tops[top - 1 - index]))
+            return false;
+    for (xword index = 0; index < bottom; ++index)
+        if (!update(1 + maxDepth + index, bottoms[bottom - 1 - index]))
+            return false;
+
+    return true;
+}
+
+/// @}
+
+/// @ingroup Methods
+/// @{
+
+/**
+ * @brief Runs the loop in closed form, starting at its lbrace; returns false
+ *      if it has to be run normally instead
+ */
+bool Loop::Run() const
+{
+    if (Memory::Size() < top + bottom)
+        return false;
+
+    Integer& counter = Memory::At(0);
+    if (counter.IsZero())
+        return true;
+    if (counter.IsNegative() != (step > 0))
+        return false;
+
+    // The iterations (n) and the sum of the counters over them, s0 * (n + 1) / 2
+    Integer count(counter), sum(counter);
+    if (step > 0)
+        count.Negate();
+    sum *= count + Integer(1);
+    sum.Halve();
+
+    for (const Update& update : updates)
+    {
+        Integer value = Evaluate(update.form);
+        long coefficient = update.form[1];
+
+        if (update.kind == Kind::Accumulate)
+        {
+            value *= count;
+            if (coefficient)
+            {
+                Integer term(std::labs(coefficient), coefficient < 0);
+                term *= sum;
+                value += term;
+            }
+            Value(update.variable) += value;
+        }
+        else
+        {
+            // The counter is -step in the last iteration
+            coefficient *= -step;
+            value += Integer(std::labs(coefficient), coefficient < 0);
+            Value(update.variable) = std::move(value);
+        }
+    }
+    counter = Integer(0);
+
+    return true;
+}
+
+/// @}
+
+#endif  // LOOP_HPP
@@ -6,120 +6,262 @@
 #ifndef MEMORY_HPP
 #define MEMORY_HPP
 
+#include <cstdlib>
 #include <algorithm>
-#include <deque>
 #include <iostream>
+#include <new>
 
 #include "Integer.hpp"
 
+#ifndef GLYPHO_MEMORY_CAPACITY
+#define GLYPHO_MEMORY_CAPACITY 64
+#endif
+
 /**
  * @class Memory
- * @brief Implements the Glypho stack-like memory using the STL's std::dequeue
- * @note All members are static to simplify the singleton pattern
+ * @brief Implements the Glypho stack-like memory as a circular buffer
+ * @details The values are kept contiguously in a buffer with a power of two
+ *          capacity starting from the head index (the top of the stack) and
+ *          wrapping around its end; rotations only move the head (and at
+ *          most one value when the buffer is not full). The operations
+ *          that throw on a memory too small for them can skip the check
+ *          (checked = false) where the size is known to suffice
+ * @note All members are static (and per thread) to simplify the singleton
+ *       pattern
  */
 class Memory
 {   
+    /// @defgroup Friends
+    friend class Jit;
+
     /// @defgroup Static Fields
     private:
-        static std::deque<Integer> data;
+        static thread_local Integer* data;
+        static thread_local xword capacity;
+        static thread_local xword head;
+        static thread_local xword size;
+
+    /// @defgroup Private Static Methods
+    private:
+        static Integer& Slot(xword index);
+        static void Grow();
 
     /// @defgroup Static Methods
     public:
+        static xword Size();
+        static Integer& At(xword index);
         static void Push(const Integer& integer);
         static void Push(Integer&& integer);
         static Integer Pop();
         static Integer& Peek();
-        static void RemoveTop();
-        static void ShiftUp();
-        static void ShiftDown();
-        static void DuplicateTop();
-        static void SwapTop();
+        template <bool checked = true> static void RemoveTop();
+        template <bool checked = true> static void ShiftUp();
+        template <bool checked = true> static void ShiftDown();
+        static void Rotate(long count);
+        template <bool checked = true> static void DuplicateTop();
+        template <bool checked = true> static void SwapTop();
+        static void Clear();
+        static void Release();
         static void Dump();
 };
 
 /// @ingroup Static Fields
-inline std::deque<Integer> Memory::data;
+/// @{
+inline thread_local Integer* Memory::data = nullptr;
+inline thread_local xword Memory::capacity = 0;
+inline thread_local xword Memory::head = 0;
+inline thread_local xword Memory::size = 0;
+/// @}
+
+/// @ingroup Private Static Methods
+/// @{
+
+// Returns the slot with the given (wrapped) distance from the head
+INLINE Integer& Memory::Slot(xword index)
+{
+    return data[(head + index) & (capacity - 1)];
+}
+
+// Doubles the capacity, moving the values to the start of the new buffer
+void Memory::Grow()
+{
+    xword newCapacity = capacity ? capacity << 1 : GLYPHO_MEMORY_CAPACITY;
+    Integer* newData = (Integer*) malloc(newCapacity * sizeof(Integer));
+
+    for (xword index = 0; index < size; ++index)
+    {
+        new (newData + index) Integer(std::move(Slot(index)));
+        Slot(index).~Integer();
+    }
+
+    free(data);
+    data = newData;
+    capacity = newCapacity;
+    head = 0;
+}
+
+/// @}
 
 /// @ingroup Static Methods
 /// @{
 
+INLINE xword Memory::Size()
+{
+    return size;
+}
+
+// Returns the value at the given depth (0 being the top)
+INLINE Integer& Memory::At(xword index)
+{
+    return Slot(index);
+}
+
 INLINE void Memory::Push(const Integer& integer)
 {
-    data.push_front(integer);
+    if (size == capacity)
+        Grow();
+
+    head = (head - 1) & (capacity - 1);
+    new (data + head) Integer(integer);
+    ++size;
 }
 
 INLINE void Memory::Push(Integer&& integer)
 {
-    data.push_front(std::move(integer));
+    if (size == capacity)
+        Grow();
+
+    head = (head - 1) & (capacity - 1);
+    new (data + head) Integer(std::move(integer));
+    ++size;
 }
 
-INLINE void Memory::RemoveTop()
+template <bool checked> INLINE void Memory::RemoveTop()
 {
-    if (data.empty())
+    if (checked && size == 0)
         throw 0;
 
-    data.pop_front();
+    data[head].~Integer();
+    head = (head + 1) & (capacity - 1);
+    --size;
 }
 
 INLINE Integer Memory::Pop()
 {
-    if (data.empty())
+    if (size == 0)
         throw 0;
 
-    Integer value = std::move(data.front());
-    data.pop_front();
+    Integer value = std::move(data[head]);
+    data[head].~Integer();
+    head = (head + 1) & (capacity - 1);
+    --size;
     return value;
 }
 
 INLINE Integer& Memory::Peek()
 {
-    if (data.empty())
+    if (size == 0)
+        throw 0;
+
+    return data[head];
+}
+
+template <bool checked> INLINE void Memory::ShiftUp()
+{
+    if (checked && size == 0)
         throw 0;
 
-    return data.front();
+    if (size != capacity)
+    {
+        new (&Slot(size)) Integer(std::move(data[head]));
+        data[head].~Integer();
+    }
+    head = (head + 1) & (capacity - 1);
 }
 
-INLINE void Memory::ShiftUp()
+template <bool checked> INLINE void Memory::ShiftDown()
 {
-    if (data.empty())
+    if (checked && size == 0)
         throw 0;
 
-    Integer value = std::move(data.front());
-    data.pop_front();
-    data.push_back(std::move(value));
+    head = (head - 1) & (capacity - 1);
+    if (size != capacity)
+    {
+        new (data + head) Integer(std::move(Slot(size)));
+        Slot(size).~Integer();
+    }
 }
 
-INLINE void Memory::ShiftDown()
+/**
+ * @brief Moves the top to the bottom count times (the bottom to the top for
+ *      a negative count); the equivalent rotation with the fewest moves of
+ *      values is done
+ */
+INLINE void Memory::Rotate(long count)
 {
-    if (data.empty())
+    if (size == 0)
         throw 0;
 
-    Integer value = std::move(data.back());
-    data.pop_back();
-    data.push_front(std::move(value));
+    xword shift = count % (long) size + (count % (long) size < 0 ? size : 0);
+    if (size == capacity)
+    {
+        head = (head + shift) & (capacity - 1);
+    }
+    else if (shift <= size / 2)
+    {
+        while (shift--)
+            ShiftUp<false>();
+    }
+    else
+    {
+        for (shift = size - shift; shift; --shift)
+            ShiftDown<false>();
+    }
 }
 
-INLINE void Memory::DuplicateTop()
+template <bool checked> INLINE void Memory::DuplicateTop()
 {
-    if (data.empty())
+    if (checked && size == 0)
         throw 0;
 
-    data.push_front(data.front());
+    if (size == capacity)
+        Grow();
+
+    xword top = head;
+    head = (head - 1) & (capacity - 1);
+    new (data + head) Integer(data[top]);
+    ++size;
 }
 
-INLINE void Memory::SwapTop()
+template <bool checked> INLINE void Memory::SwapTop()
 {
-    if (data.size() < 2)
+    if (checked && size < 2)
         throw 0;
 
-    auto iterator = data.begin();
-    std::iter_swap(iterator, iterator + 1);
+    data[head].Swap(Slot(1));
+}
+
+// Removes all the values (keeping the buffer)
+INLINE void Memory::Clear()
+{
+    for (xword index = 0; index < size; ++index)
+        Slot(index).~Integer();
+    head = size = 0;
+}
+
+// Clears the memory of the calling thread and frees its buffer
+INLINE void Memory::Release()
+{
+    Clear();
+    free(data);
+    data = nullptr;
+    capacity = 0;
 }
 
 INLINE void Memory::Dump()
 {
-    for (xword i = 0; i < data.size(); ++i)
-        std::cout << "MEM_DUMP [" << i << "]: " << data[i].ToString() << std::endl;
+    for (xword i = 0; i < size; ++i)
+        std::cout << "MEM_DUMP [" << i << "]: " << At(i).ToString() << std::endl;
     std::cout << std::endl;
 }
 
@@ -0,0 +1,309 @@
+/// ============================
+/// @author Andrei Biu - Pislaru
+/// @brief Implementation of Ntt "static" class
+/// ============================
+
+#ifndef NTT_HPP
+#define NTT_HPP
+
+#include <cstdlib>
+#include <algorithm>
+
+#include "Parallel.hpp"
+#include "Typedefs.hpp"
+
+#if defined(__SIZEOF_INT128__) && defined(__x86_64__)
+#define GLYPHO_NTT 1
+
+/**
+ * @class Ntt
+ * @brief Multiplication of very large limb arrays using number theoretic
+ *        transforms modulo three primes of the form c * 2^k + 1 (below 2^62)
+ *        followed by the reconstruction of the convolution using the
+ *        chinese remainder theorem; modular arithmetic is done in the
+ *        Montgomery representation (R = 2^64); the convolutions modulo
+ *        the three primes are independent and run in parallel for the
+ *        wide products
+ * @note All members are static to simplify the singleton pattern
+ */
+class Ntt
+{
+    /// @defgroup Nested Types
+    private:
+        using qword = unsigned __int128;
+
+        struct Prime
+        {
+            xword modulus;
+            xword generator;
+            xword inverse;      // -modulus^-1 mod R
+            xword r1;           // R mod modulus
+            xword r2;           // R^2 mod modulus
+
+            constexpr Prime(xword modulus, xword generator) :
+                modulus(modulus), generator(generator), inverse(Inverse(modulus)),
+                r1((0 - modulus) % modulus), r2((xword) ((qword) r1 * r1 % modulus)) {}
+
+            static constexpr xword Inverse(xword modulus)
+            {
+                xword inverse = modulus;
+                for (int i = 0; i < 6; ++i)
+                    inverse *= 2 - modulus * inverse;
+                return 0 - inverse;
+            }
+        };
+
+    /// @defgroup Static Fields
+    private:
+        static const Prime primes[3];
+
+    /// @defgroup Private Static Methods
+    private:
+        static xword Reduce(qword value, const Prime& prime);
+        static xword Multiply(xword left, xword right, const Prime& prime);
+        static xword Add(xword left, xword right, const Prime& prime);
+        static xword Subtract(xword left, xword right, const Prime& prime);
+        static xword Power(xword base, xword exponent, const Prime& prime);
+        static void Roots(xword* roots, xword size, bool inverse, const Prime& prime);
+        static void Forward(xword* data, xword size, const xword* roots, const Prime& prime);
+        static void Backward(xword* data, xword size, const xword* roots, const Prime& prime);
+        static void Load(xword* data, xword size, const xword* limbs, xword width, const Prime& prime);
+        static void Convolve(xword* residues, xword* buffer, xword size, const xword* left, xword leftWidth,
+                             const xword* right, xword rightWidth, const Prime& prime);
+        static void Reconstruct(xword* result, xword resultWidth, const xword* residues, xword stride);
+
+    /// @defgroup Public Static Methods
+    public:
+        static void Multiply(xword* result, const xword* left, xword leftWidth,
+                             const xword* right, xword rightWidth);
+};
+
+
+/// @ingroup Static Fields
+inline constexpr Ntt::Prime Ntt::primes[3] = {
+    Ntt::Prime(4512606826625236993ull, 7),       // 501 * 2^53 + 1
+    Ntt::Prime(4242390848983007233ull, 11),      // 471 * 2^53 + 1
+    Ntt::Prime(4134304457926115329ull, 7)        // 459 * 2^53 + 1
+};
+
+/// @ingroup Private Static Methods
+/// @{
+
+INLINE xword Ntt::Reduce(qword value, const Prime& prime)
+{
+    xword factor = (xword) value * prime.inverse;
+    xword result = (xword) ((value + (qword) factor * prime.modulus) >> 64);
+    return result >= prime.modulus ? result - prime.modulus : result;
+}
+
+INLINE xword Ntt::Multiply(xword left, xword right, const Prime& prime)
+{
+    return Reduce((qword) left * right, prime);
+}
+
+INLINE xword Ntt::Add(xword left, xword right, const Prime& prime)
+{
+    xword result = left + right;
+    return result >= prime.modulus ? result - prime.modulus : result;
+}
+
+INLINE xword Ntt::Subtract(xword left, xword right, const Prime& prime)
+{
+    return left >= right ? left - right : left + prime.modulus - right;
+}
+
+// Exponentiation of a value in Montgomery form
+INLINE xword Ntt::Power(xword base, xword exponent, const Prime& prime)
+{
+    xword result = prime.r1;
+
+    while (exponent)
+    {
+        if (exponent & 1)
+            result = Multiply(result, base, prime);
+        base = Multiply(base, base, prime);
+        exponent >>= 1;
+    }
+
+    return result;
+}
+
+// Fills roots[length + j] = w^j (j < length) for each level length of the
+// transform, w being a primitive (2 * length)-th root of unity
+INLINE void Ntt::Roots(xword* roots, xword size, bool inverse, const Prime& prime)
+{
+    xword generator = Multiply(prime.generator, prime.r2, prime);
+
+    for (xword length = 1; length < size; length <<= 1)
+    {
+        xword root = Power(generator, (prime.modulus - 1) / (length << 1), prime);
+        if (inverse)
+            root = Power(root, (length << 1) - 1, prime);
+
+        roots[length] = prime.r1;
+        for (xword j = 1; j < length; ++j)
+            roots[length + j] = Multiply(roots[length + j - 1], root, prime);
+    }
+}
+
+// Decimation in frequency transform; the output is in bit-reversed order
+INLINE void Ntt::Forward(xword* data, xword size, const xword* roots, const Prime& prime)
+{
+    for (xword length = size >> 1; length; length >>= 1)
+        for (xword start = 0; start < size; start += length << 1)
+            for (xword j = 0; j < length; ++j)
+            {
+                xword u = data[start + j], v = data[start + j + length];
+                data[start + j] = Add(u, v, prime);
+                data[start + j + length] = Multiply(Subtract(u, v, prime), roots[length + j], prime);
+            }
+}
+
+// Decimation in time transform; the input is in bit-reversed order
+INLINE void Ntt::Backward(xword* data, xword size, const xword* roots, const Prime& prime)
+{
+    for (xword length = 1; length < size; length <<= 1)
+        for (xword start = 0; start < size; start += length << 1)
+            for (xword j = 0; j < length; ++j)
+            {
+                xword u = data[start + j], v = Multiply(data[start + j + length], roots[length + j], prime);
+                data[start + j] = Add(u, v, prime);
+                data[start + j + length] = Subtract(u, v, prime);
+            }
+}
+
+// Converts the limbs to Montgomery form residues padded with zeros
+INLINE void Ntt::Load(xword* data, xword size, const xword* limbs, xword width, const Prime& prime)
+{
+    for (xword index = 0; index < width; ++index)
+        data[index] = Multiply(limbs[index], prime.r2, prime);
+    std::fill(data + width, data + size, 0);
+}
+
+/**
+ * @brief Computes the cyclic convolution of the operands modulo one prime
+ *      into residues (normal form); when the operands are the same array the
+ *      forward transform is done only once (squaring)
+ */
+void Ntt::Convolve(xword* residues, xword* buffer, xword size, const xword* left, xword leftWidth,
+                   const xword* right, xword rightWidth, const Prime& prime)
+{
+    xword *roots = buffer, *data = buffer + size;
+    bool square = left == right && leftWidth == rightWidth;
+
+    Roots(roots, size, false, prime);
+    Load(residues, size, left, leftWidth, prime);
+    Forward(residues, size, roots, prime);
+    if (square)
+    {
+        for (xword index = 0; index < size; ++index)
+            residues[index] = Multiply(residues[index], residues[index], prime);
+    }
+    else
+    {
+        Load(data, size, right, rightWidth, prime);
+        Forward(data, size, roots, prime);
+        for (xword index = 0; index < size; ++index)
+            residues[index] = Multiply(residues[index], data[index], prime);
+    }
+
+    // The scaling by 1 / size also converts the values out of Montgomery form
+    xword scale = Power(Multiply(size, prime.r2, prime), prime.modulus - 2, prime);
+    scale = Reduce(scale, prime);
+    Roots(roots, size, true, prime);
+    Backward(residues, size, roots, prime);
+    for (xword index = 0; index < size; ++index)
+        residues[index] = Multiply(residues[index], scale, prime);
+}
+
+/**
+ * @brief Combines the three residues of each convolution coefficient
+ *      (Garner's algorithm) and propagates the carries into result
+ */
+void Ntt::Reconstruct(xword* result, xword resultWidth, const xword* residues, xword stride)
+{
+    const Prime &prime0 = primes[0], &prime1 = primes[1], &prime2 = primes[2];
+
+    // Constants in Montgomery form such that Multiply(x, c) = x * constant
+    const xword inverse01 = Power(Multiply(prime0.modulus % prime1.modulus, prime1.r2, prime1),
+                                  prime1.modulus - 2, prime1),
+                modulus0 = Multiply(prime0.modulus % prime2.modulus, prime2.r2, prime2),
+                inverse012 = Power(Multiply((xword) ((qword) prime0.modulus * prime1.modulus % prime2.modulus),
+                                            prime2.r2, prime2), prime2.modulus - 2, prime2);
+    const qword modulus01 = (qword) prime0.modulus * prime1.modulus;
+    xword carry[3] = { 0, 0, 0 };
+
+    for (xword index = 0; index < resultWidth; ++index)
+    {
+        xword value0 = 0, value1 = 0, value2 = 0;
+
+        if (index < stride)
+        {
+            xword x0 = residues[index], x1 = residues[stride + index], x2 = residues[(stride << 1) + index];
+            xword y0 = x0, y1, y2;
+
+            y1 = Multiply(Subtract(x1, x0 % prime1.modulus, prime1), inverse01, prime1);
+            y2 = Subtract(x2, x0 % prime2.modulus, prime2);
+            y2 = Subtract(y2, Multiply(y1, modulus0, prime2), prime2);
+            y2 = Multiply(y2, inverse012, prime2);
+
+            // value = y0 + y1 * p0 + y2 * p0 * p1
+            qword temp = (qword) y1 * prime0.modulus + y0;
+            value1 = (xword) (temp >> 64);
+            temp = (qword) y2 * (xword) modulus01 + (xword) temp;
+            value0 = (xword) temp;
+            temp = (qword) y2 * (xword) (modulus01 >> 64) + value1 + (xword) (temp >> 64);
+            value1 = (xword) temp;
+            value2 = (xword) (temp >> 64);
+        }
+
+        qword sum = (qword) carry[0] + value0;
+        result[index] = (xword) sum;
+        sum = (qword) carry[1] + value1 + (xword) (sum >> 64);
+        carry[0] = (xword) sum;
+        sum = (qword) carry[2] + value2 + (xword) (sum >> 64);
+        carry[1] = (xword) sum;
+        carry[2] = (xword) (sum >> 64);
+    }
+}
+
+/// @}
+
+/// @ingroup Public Static Methods
+/// @{
+
+/**
+ * @brief Multiplies two limb arrays into result (leftWidth + rightWidth limbs);
+ *      the product is a squaring if the operands are the same array
+ */
+void Ntt::Multiply(xword* result, const xword* left, xword leftWidth,
+                   const xword* right, xword rightWidth)
+{
+    xword length = leftWidth + rightWidth - 1, size = 1;
+    bool parallel = std::min(leftWidth, rightWidth) >= Parallel::Threshold() && Parallel::Threads() > 1;
+
+    while (size < length)
+        size <<= 1;
+
+    // Each parallel convolution needs its own buffer
+    xword* residues = (xword*) malloc(size * 3 * sizeof(xword));
+    xword* buffer = (xword*) malloc(size * (parallel ? 6 : 2) * sizeof(xword));
+
+    auto convolve = [&] (xword index) {
+        return [=] {
+            Convolve(residues + index * size, buffer + (parallel ? index * size * 2 : 0), size,
+                     left, leftWidth, right, rightWidth, primes[index]);
+        };
+    };
+    Parallel::Invoke(parallel, convolve(0), convolve(1), convolve(2));
+    Reconstruct(result, leftWidth + rightWidth, residues, size);
+
+    free(buffer);
+    free(residues);
+}
+
+/// @}
+
+#endif  // __SIZEOF_INT128__ && __x86_64__
+
+#endif  // NTT_HPP
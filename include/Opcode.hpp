@@ -0,0 +1,34 @@
+/// ============================
+/// @author Andrei Biu - Pislaru
+/// @brief Operation codes of compiled Glypho programs
+/// ============================
+
+#ifndef OPCODE_HPP
+#define OPCODE_HPP
+
+#include "Typedefs.hpp"
+
+/**
+ * @enum Opcode
+ * @brief The operations of a compiled Glypho program: one for each
+ *        instruction type, the end of the code, the superinstructions
+ *        that replace common sequences of instructions and the variants of
+ *        the instructions that skip the checks of the memory size
+ */
+enum Opcode : byte
+{
+    Halt, Nop, Input, Rot, Swap, Push, RRot, Dup,
+    Add, Lbrace, Output, Multiply, Execute, Negate, Pop, Rbrace,
+    End,
+    PushConstant,   // runs of 1 and + leaving a single value
+    AddConstant,    // the above followed by + (or -+)
+    Square,         // d*
+    Double,         // d+
+    Rotate,         // runs of > and <
+    CountedLoop,    // loops run in closed form
+    RotUnchecked, SwapUnchecked, RRotUnchecked, DupUnchecked,
+    AddUnchecked, LbraceUnchecked, MultiplyUnchecked, NegateUnchecked,
+    PopUnchecked    // the above instructions on a memory known to hold their operands
+};
+
+#endif  // OPCODE_HPP
@@ -0,0 +1,338 @@
+/// ============================
+/// @author Andrei Biu - Pislaru
+/// @brief Implementation of Output "static" class
+/// ============================
+
+#ifndef OUTPUT_HPP
+#define OUTPUT_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+#include <thread>
+#include "Integer.hpp"
+
+#ifndef GLYPHO_OUTPUT_CAPACITY
+#define GLYPHO_OUTPUT_CAPACITY 65536
+#endif
+
+#ifndef GLYPHO_OUTPUT_QUEUE
+#define GLYPHO_OUTPUT_QUEUE 1024
+#endif
+
+/**
+ * @class Output
+ * @brief Buffers the numbers written by the programs, so that the standard
+ *        output is written in large blocks instead of once per number
+ * @details The numbers are rendered directly into the buffer (which grows
+ *          for the numbers wider than it); the buffer is written when full,
+ *          on every exit of the interpreter and, in line buffered mode (for
+ *          the interactive use), after every number. The buffer is written
+ *          to the standard output unless a thread opens another stream or a
+ *          sink (a callback receiving the blocks, for its contained runs).
+ *          In pipelined mode the numbers of the thread are moved into a
+ *          bounded single producer, single consumer queue instead, a writer
+ *          thread (started by the first one) converting and writing them in
+ *          order; a flush waits for the writer to write all the numbers
+ *          queued before it, so the output is the same as in the direct
+ *          mode at every flush (before reading the input and on every exit)
+ * @note All members are static (and per thread) to simplify the singleton
+ *       pattern
+ */
+class Output
+{
+    /// @defgroup Nested Types
+    public:
+        using Sink = void (*)(const char* data, xword size, void* context);
+
+    /// @defgroup Static Fields
+    private:
+        static thread_local FILE* stream;
+        static thread_local Sink sink;
+        static thread_local void* sinkContext;
+        static thread_local char* buffer;
+        static thread_local xword capacity;
+        static thread_local xword size;
+        static thread_local bool lineBuffered;
+        static thread_local bool pipelined;
+
+        // The queue of the pipelined mode (a ring of queueCapacity numbers)
+        static constexpr xword queueCapacity = GLYPHO_OUTPUT_QUEUE;
+        static Integer* queue;
+        static byte queueBases[queueCapacity];
+        alignas(64) static std::atomic<xword> head;     // the count of queued numbers
+        alignas(64) static std::atomic<xword> tail;     // the count of converted numbers
+        static xword tailSeen;                          // the last tail seen by the producer
+        static std::atomic<xword> requested;    // the count to be flushed
+        static std::atomic<xword> written;      // the count flushed
+        static std::atomic<bool> sleeping;
+        static std::atomic<bool> stopping;
+        static std::mutex mutex;
+        static std::condition_variable wake;
+        static std::thread writer;
+
+    /// @defgroup Static Getters & Setters
+    public:
+        static bool LineBuffered();
+        static void LineBuffered(bool lineBuffered);
+        static void Pipelined(bool pipelined);
+
+    /// @defgroup Private Static Methods
+    private:
+        static void Start();
+        static void Enqueue(Integer&& integer, byte base);
+        static void Wake();
+        static void Consume();
+        static void Drain();
+
+    /// @defgroup Static Methods
+    public:
+        static void Open(FILE* stream);
+        static void Open(Sink sink, void* context);
+        static void Write(const Integer& integer, byte base);
+        static void Write(Integer&& integer, byte base);
+        static void Flush();
+        static void Close();
+        static void Release();
+};
+
+
+/// @ingroup Static Fields
+/// @{
+inline thread_local FILE* Output::stream = nullptr;
+inline thread_local Output::Sink Output::sink = nullptr;
+inline thread_local void* Output::sinkContext = nullptr;
+inline thread_local char* Output::buffer = nullptr;
+inline thread_local xword Output::capacity = 0;
+inline thread_local xword Output::size = 0;
+inline thread_local bool Output::lineBuffered = false;
+inline thread_local bool Output::pipelined = false;
+inline Integer* Output::queue = nullptr;
+inline byte Output::queueBases[queueCapacity];
+alignas(64) inline std::atomic<xword> Output::head(0);
+alignas(64) inline std::atomic<xword> Output::tail(0);
+inline xword Output::tailSeen = 0;
+inline std::atomic<xword> Output::requested(0);
+inline std::atomic<xword> Output::written(0);
+inline std::atomic<bool> Output::sleeping(false);
+inline std::atomic<bool> Output::stopping(false);
+inline std::mutex Output::mutex;
+inline std::condition_variable Output::wake;
+inline std::thread Output::writer;
+/// @}
+
+/// @ingroup Static Getters & Setters
+/// @{
+INLINE bool Output::LineBuffered() { return lineBuffered; }
+INLINE void Output::LineBuffered(bool lineBuffered) { Output::lineBuffered = lineBuffered; }
+INLINE void Output::Pipelined(bool pipelined) { Output::pipelined = pipelined; }
+/// @}
+
+/// @ingroup Private Static Methods
+/// @{
+
+// Starts the writer thread (with the line buffering of the calling thread)
+void Output::Start()
+{
+    static_assert((queueCapacity & (queueCapacity - 1)) == 0, "The output queue needs a power of two capacity");
+
+    queue = (Integer*) malloc(queueCapacity * sizeof(Integer));
+    head = tail = requested = written = tailSeen = 0;
+    stopping = false;
+    writer = std::thread([lineBuffered = lineBuffered] {
+        Output::lineBuffered = lineBuffered;
+        Consume();
+    });
+}
+
+// Queues a number, waiting for room while the queue is full (the tail is
+// only read again when the last one seen leaves no room)
+INLINE void Output::Enqueue(Integer&& integer, byte base)
+{
+    xword position = head.load(std::memory_order_relaxed);
+
+    while (position - tailSeen == queueCapacity)
+    {
+        tailSeen = tail.load(std::memory_order_acquire);
+        if (position - tailSeen == queueCapacity)
+            std::this_thread::yield();
+    }
+
+    new (queue + (position & (queueCapacity - 1))) Integer(std::move(integer));
+    queueBases[position & (queueCapacity - 1)] = base;
+    head.store(position + 1);
+    Wake();
+}
+
+// Wakes the writer if it sleeps (the sequentially consistent order of its
+// flag and of the counters keeps a wake up from being lost)
+INLINE void Output::Wake()
+{
+    if (sleeping.load())
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        wake.notify_one();
+    }
+}
+
+// The loop of the writer thread: converts the queued numbers into its own
+// buffer, writing this when requested, and sleeps while there is no work
+void Output::Consume()
+{
+    xword position = 0, flushed = 0;
+
+    for (;;)
+    {
+        for (xword end = head.load(std::memory_order_acquire); position != end; )
+        {
+            Integer& integer = queue[position & (queueCapacity - 1)];
+
+            Write(integer, queueBases[position & (queueCapacity - 1)]);
+            integer.~Integer();
+            tail.store(++position, std::memory_order_release);
+        }
+        if (position != head.load(std::memory_order_acquire))
+            continue;
+        if (requested.load(std::memory_order_acquire) > flushed)
+        {
+            Flush();
+            written.store(flushed = position, std::memory_order_release);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(mutex);
+        sleeping = true;
+        wake.wait(lock, [&] { return position != head || requested > flushed || stopping; });
+        sleeping = false;
+        if (position == head && requested <= flushed && stopping)
+            return;
+    }
+}
+
+// Waits until the writer has written all the queued numbers
+void Output::Drain()
+{
+    xword target = head.load(std::memory_order_relaxed);
+
+    requested.store(target);
+    Wake();
+    while (written.load(std::memory_order_acquire) < target)
+        std::this_thread::yield();
+}
+
+/// @}
+
+/// @ingroup Static Methods
+/// @{
+
+// Makes the output of the calling thread a stream (the standard output if
+// null), flushing the previous one
+INLINE void Output::Open(FILE* stream)
+{
+    Flush();
+    Output::stream = stream;
+    sink = nullptr;
+}
+
+// Makes the output of the calling thread a sink, flushing the previous one
+INLINE void Output::Open(Sink sink, void* context)
+{
+    Flush();
+    Output::sink = sink;
+    sinkContext = context;
+}
+
+// Writes a number in base followed by a new line
+INLINE void Output::Write(const Integer& integer, byte base)
+{
+    xword length = integer.ToStringLength(base) + 1;
+
+    if (size + length > capacity)
+    {
+        Flush();
+        if (length > capacity)
+        {
+            capacity = std::max<xword>(length, GLYPHO_OUTPUT_CAPACITY);
+            buffer = (char*) realloc(buffer, capacity);
+        }
+    }
+
+    size += integer.ToString(buffer + size, base);
+    buffer[size++] = '\n';
+    if (lineBuffered)
+        Flush();
+}
+
+// Writes a number that is no longer needed (queued in pipelined mode)
+INLINE void Output::Write(Integer&& integer, byte base)
+{
+    if (!pipelined)
+        return Write(integer, base);
+
+    if (!writer.joinable())
+        Start();
+    Enqueue(std::move(integer), base);
+}
+
+// Writes the buffered output to the standard output (or the opened one)
+INLINE void Output::Flush()
+{
+    if (pipelined)
+    {
+        if (writer.joinable())
+            Drain();
+        return;
+    }
+
+    if (sink)
+    {
+        if (size)
+            sink(buffer, size, sinkContext);
+        size = 0;
+        return;
+    }
+
+    FILE* file = stream ? stream : stdout;
+
+    if (size)
+    {
+        fwrite(buffer, 1, size, file);
+        size = 0;
+    }
+    fflush(file);
+}
+
+// Flushes the output at the end of a run, stopping the writer thread of the
+// pipelined mode
+INLINE void Output::Close()
+{
+    Flush();
+    if (pipelined && writer.joinable())
+    {
+        stopping = true;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            wake.notify_one();
+        }
+        writer.join();
+        free(queue);
+        queue = nullptr;
+    }
+}
+
+// Flushes the output of the calling thread and frees its buffer
+INLINE void Output::Release()
+{
+    Flush();
+    free(buffer);
+    buffer = nullptr;
+    capacity = 0;
+}
+
+/// @}
+
+#endif  // OUTPUT_HPP
@@ -0,0 +1,296 @@
+/// ============================
+/// @author Andrei Biu - Pislaru
+/// @brief Implementation of Parallel "static" class
+/// ============================
+
+#ifndef PARALLEL_HPP
+#define PARALLEL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "Typedefs.hpp"
+
+#ifndef GLYPHO_THREADS
+#define GLYPHO_THREADS 0
+#endif
+
+#ifndef GLYPHO_PARALLEL_THRESHOLD
+#define GLYPHO_PARALLEL_THRESHOLD 2000
+#endif
+
+/**
+ * @class Parallel
+ * @brief Runs independent tasks (the sub-products of the big multiplications)
+ *        on a pool of worker threads with work stealing
+ * @details Every thread that forks tasks has a deque of them: it queues the
+ *          forked tasks at the back of its deque and runs the first one
+ *          itself, then, until all are done, runs the tasks from the back of
+ *          its deque or steals them from the front of the other deques (so a
+ *          thread waiting for its tasks helps with the others instead of
+ *          blocking). The idle workers steal the same way and sleep while no
+ *          task is queued. The tasks write disjoint parts of the results, so
+ *          these do not depend on the scheduling. The pool (of threads - 1
+ *          workers, 0 threads meaning one per hardware thread) is started by
+ *          the first fork; the products narrower than threshold limbs (and
+ *          all of them, if there is a single thread) are run serially
+ * @note All members are static to simplify the singleton pattern
+ */
+class Parallel
+{
+    /// @defgroup Nested Types
+    private:
+        struct Task
+        {
+            void (*function)(void*);
+            void* context;
+            std::atomic<xword>* pending;
+        };
+
+        struct Deque
+        {
+            std::mutex mutex;
+            std::deque<Task> tasks;
+        };
+
+        // The deque of a forking thread, removed from the pool when it exits
+        struct Owner
+        {
+            Deque* deque = nullptr;
+
+            ~Owner();
+        };
+
+        // The shared state, never destroyed (the workers outlive the exit)
+        struct Pool
+        {
+            std::mutex mutex;
+            std::condition_variable wake;
+            std::vector<Deque*> deques;
+            std::atomic<xword> queued { 0 };
+            std::atomic<xword> sleeping { 0 };
+        };
+
+    /// @defgroup Static Fields
+    private:
+        static xword threads;
+        static xword threshold;
+        static Pool* pool;
+        static std::once_flag started;
+        static thread_local Owner owner;
+
+    /// @defgroup Static Getters & Setters
+    public:
+        static xword Threads();
+        static void Threads(xword threads);
+        static xword Threshold();
+        static void Threshold(xword threshold);
+
+    /// @defgroup Private Static Methods
+    private:
+        static xword Resolve(xword threads);
+        static void Start();
+        static Deque& Own();
+        static bool Pop(Deque& deque, Task& task);
+        static bool Steal(Deque& deque, Task& task);
+        static void Execute(const Task& task);
+        static void Work();
+        static void Fork(Task* tasks, xword count);
+
+    /// @defgroup Static Methods
+    public:
+        template <typename... F> static void Invoke(bool parallel, F&&... functions);
+};
+
+
+/// @ingroup Static Fields
+/// @{
+inline xword Parallel::threads = Parallel::Resolve(GLYPHO_THREADS);
+inline xword Parallel::threshold = GLYPHO_PARALLEL_THRESHOLD;
+inline Parallel::Pool* Parallel::pool = nullptr;
+inline std::once_flag Parallel::started;
+inline thread_local Parallel::Owner Parallel::owner;
+/// @}
+
+/// @ingroup Static Getters & Setters
+/// @{
+INLINE xword Parallel::Threads() { return threads; }
+INLINE void Parallel::Threads(xword threads) { Parallel::threads = Resolve(threads); }
+INLINE xword Parallel::Threshold() { return threshold; }
+INLINE void Parallel::Threshold(xword threshold) { Parallel::threshold = std::max<xword>(threshold, 4); }
+/// @}
+
+/// @ingroup Nested Types
+/// @{
+
+inline Parallel::Owner::~Owner()
+{
+    if (!deque)
+        return;
+
+    std::lock_guard<std::mutex> lock(pool->mutex);
+    pool->deques.erase(std::find(pool->deques.begin(), pool->deques.end(), deque));
+    delete deque;
+}
+
+/// @}
+
+/// @ingroup Private Static Methods
+/// @{
+
+INLINE xword Parallel::Resolve(xword threads)
+{
+    return threads ? threads : std::max<xword>(1, std::thread::hardware_concurrency());
+}
+
+// Starts the workers (their count is fixed by the first fork)
+void Parallel::Start()
+{
+    pool = new Pool;
+    for (xword index = 1; index < threads; ++index)
+        std::thread(Work).detach();
+}
+
+// Returns the deque of the calling thread, adding it to the pool on first use
+INLINE Parallel::Deque& Parallel::Own()
+{
+    if (!owner.deque)
+    {
+        owner.deque = new Deque;
+        std::lock_guard<std::mutex> lock(pool->mutex);
+        pool->deques.push_back(owner.deque);
+    }
+    return *owner.deque;
+}
+
+// Takes the last task of the deque of the calling thread
+INLINE bool Parallel::Pop(Deque& deque, Task& task)
+{
+    std::lock_guard<std::mutex> lock(deque.mutex);
+
+    if (deque.tasks.empty())
+        return false;
+    task = deque.tasks.back();
+    deque.tasks.pop_back();
+    --pool->queued;
+    return true;
+}
+
+// Takes the first task of another deque (the oldest, usually the largest)
+bool Parallel::Steal(Deque& deque, Task& task)
+{
+    std::lock_guard<std::mutex> lock(pool->mutex);
+
+    for (Deque* other : pool->deques)
+    {
+        if (other == &deque)
+            continue;
+
+        std::lock_guard<std::mutex> otherLock(other->mutex);
+        if (!other->tasks.empty())
+        {
+            task = other->tasks.front();
+            other->tasks.pop_front();
+            --pool->queued;
+            return true;
+        }
+    }
+    return false;
+}
+
+INLINE void Parallel::Execute(const Task& task)
+{
+    task.function(task.context);
+    task.pending->fetch_sub(1, std::memory_order_release);
+}
+
+// The loop of a worker: runs the queued tasks, sleeping while there are none
+void Parallel::Work()
+{
+    Deque& deque = Own();
+    Task task;
+
+    for (;;)
+    {
+        if (Pop(deque, task) || Steal(deque, task))
+        {
+            Execute(task);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(pool->mutex);
+        ++pool->sleeping;
+        pool->wake.wait(lock, [] { return pool->queued > 0; });
+        --pool->sleeping;
+    }
+}
+
+/**
+ * @brief Runs count tasks, the first in the calling thread and the others
+ *      wherever the pool takes them, returning when all are done
+ */
+void Parallel::Fork(Task* tasks, xword count)
+{
+    std::call_once(started, Start);
+
+    Deque& deque = Own();
+    std::atomic<xword> pending(count - 1);
+    Task task;
+
+    {
+        std::lock_guard<std::mutex> lock(deque.mutex);
+        for (xword index = 1; index < count; ++index)
+        {
+            tasks[index].pending = &pending;
+            deque.tasks.push_back(tasks[index]);
+        }
+    }
+    pool->queued += count - 1;
+    if (pool->sleeping > 0)
+    {
+        std::lock_guard<std::mutex> lock(pool->mutex);
+        pool->wake.notify_all();
+    }
+
+    tasks[0].function(tasks[0].context);
+    while (pending.load(std::memory_order_acquire))
+    {
+        if (Pop(deque, task) || Steal(deque, task))
+            Execute(task);
+        else
+            std::this_thread::yield();
+    }
+}
+
+/// @}
+
+/// @ingroup Static Methods
+/// @{
+
+/**
+ * @brief Calls the functions (which must be independent), in parallel if
+ *      requested and the pool has more than one thread, in order otherwise
+ */
+template <typename... F> INLINE void Parallel::Invoke(bool parallel, F&&... functions)
+{
+    if (!parallel || threads < 2)
+    {
+        (functions(), ...);
+        return;
+    }
+
+    Task tasks[] = {
+        Task { [] (void* function) { (*(std::remove_reference_t<F>*) function)(); }, (void*) &functions, nullptr }...
+    };
+    Fork(tasks, sizeof...(F));
+}
+
+/// @}
+
+#endif  // PARALLEL_HPP
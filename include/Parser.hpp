@@ -6,86 +6,341 @@
 #ifndef PARSER_HPP
 #define PARSER_HPP
 
+#include <algorithm>
+#include <array>
+#include <cstring>
 #include <fstream>
+#include <iterator>
 #include <vector>
-#include <stack>
 #include <string>
 
+#if defined(__unix__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #include "Instruction.hpp"
 
 /**
  * @namespace Parser
  * @brief Contains functions that transform Glypho programs into arrays of
  *        instructions
+ * @details The source is scanned in a single pass over a raw span of bytes
+ *          (the memory mapped file); the symbols are the non whitespace
+ *          characters, the errors being reported exactly as the original
+ *          stream based reading did (including the counting of trailing
+ *          whitespace as an incomplete instruction); the shorthand sources
+ *          (.gsh / .glh) have a symbol per instruction instead, as given by
+ *          the instruction types
  */
 namespace Parser
 {
-    INLINE std::vector<Instruction> Parse()
+    inline constexpr byte invalidCode = 0xFF;
+
+    INLINE bool IsWhitespace(char symbol)
     {
-        bool hasError = false;
-        xword readCounter = 0, instructionIndex = 0;
-        char instructionCodeSymbols[4];
-        std::vector<Instruction> instructions;
-        std::stack<xword> lbraceIndices;
-        std::ifstream stream(Environment::ProgramFilename());
-
-        while (stream.peek() != EOF)
+        return symbol == ' ' || (symbol >= '\t' && symbol <= '\r');
+    }
+
+    // Returns the position of the first non whitespace symbol from position
+    // (or the size of the source if there is none)
+    INLINE xword SkipWhitespace(const char* source, xword size, xword position)
+    {
+    #if defined(__SSE2__)
+        const __m128i space = _mm_set1_epi8(' '), low = _mm_set1_epi8('\t' - 1), high = _mm_set1_epi8('\r' + 1);
+
+        while (position + 16 <= size)
+        {
+            __m128i symbols = _mm_loadu_si128((const __m128i*) (source + position));
+            __m128i whitespace = _mm_or_si128(_mm_cmpeq_epi8(symbols, space),
+                                              _mm_and_si128(_mm_cmpgt_epi8(symbols, low),
+                                                            _mm_cmplt_epi8(symbols, high)));
+            int mask = ~_mm_movemask_epi8(whitespace) & 0xFFFF;
+
+            if (mask)
+                return position + __builtin_ctz(mask);
+            position += 16;
+        }
+    #endif
+        while (position < size && IsWhitespace(source[position]))
+            ++position;
+
+        return position;
+    }
+
+    // Returns the position of the first whitespace symbol from position
+    // (or the size of the source if there is none)
+    INLINE xword FindWhitespace(const char* source, xword size, xword position)
+    {
+    #if defined(__SSE2__)
+        const __m128i space = _mm_set1_epi8(' '), low = _mm_set1_epi8('\t' - 1), high = _mm_set1_epi8('\r' + 1);
+
+        while (position + 16 <= size)
+        {
+            __m128i symbols = _mm_loadu_si128((const __m128i*) (source + position));
+            __m128i whitespace = _mm_or_si128(_mm_cmpeq_epi8(symbols, space),
+                                              _mm_and_si128(_mm_cmpgt_epi8(symbols, low),
+                                                            _mm_cmplt_epi8(symbols, high)));
+            int mask = _mm_movemask_epi8(whitespace);
+
+            if (mask)
+                return position + __builtin_ctz(mask);
+            position += 16;
+        }
+    #endif
+        while (position < size && !IsWhitespace(source[position]))
+            ++position;
+
+        return position;
+    }
+
+    /**
+     * @class Builder
+     * @brief Collects the parsed instructions, matching their braces
+     */
+    class Builder
+    {
+        private:
+            bool hasError = false;
+            xword instructionIndex = 0;
+            std::vector<Instruction> instructions;
+            std::vector<xword> lbraceIndices;
+
+        public:
+            Builder(xword capacity) { instructions.reserve(capacity); }
+
+            // Saves an instruction and informations about brace instructions
+            // Checks if a rbrace appears before a lbrace
+            INLINE void Append(const Instruction& instruction)
+            {
+                // Only keep reading for invalid file length if other type of
+                // error has been detected
+                if (hasError)
+                    return;
+
+                instructions.push_back(instruction);
+                if (instructions.back().Type() == Instruction::Type::Lbrace)
+                {
+                    lbraceIndices.push_back(instructionIndex);
+                }
+                if (instructions.back().Type() == Instruction::Type::Rbrace)
+                {
+                    if (lbraceIndices.empty())
+                    {
+                        hasError = true;
+                        return;
+                    }
+
+                    long offset = instructionIndex - lbraceIndices.back();
+                    instructions.back().Offset(-offset);
+                    instructions[lbraceIndices.back()].Offset(offset + 1);
+                    lbraceIndices.pop_back();
+                }
+                ++instructionIndex;
+            }
+
+            // Final checks for brace errors (an unmatched lbrace is reported
+            // at the count of instructions read)
+            INLINE std::vector<Instruction> Finish(xword readCount)
+            {
+                if (hasError)
+                    Environment::ExitError(instructionIndex);
+                if (!lbraceIndices.empty())
+                    Environment::ExitError(readCount);
+
+                return std::move(instructions);
+            }
+    };
+
+    /**
+     * @brief Parses the instructions of a program from a span of bytes in
+     *      the 4 symbols form (.gly); the errors end the program through
+     *      the environment
+     */
+    INLINE std::vector<Instruction> ParseSymbols(const char* source, xword size)
+    {
+        bool failed = false;
+        xword readCounter = 0, position = 0;
+        char instructionCodeSymbols[4] = { 0, 0, 0, 0 };
+        byte codes[256];
+        Builder builder(size / 4);
+
+        // Reads the next symbol; a failed read (only whitespace left) keeps
+        // the previous symbol and fails all the following reads
+        auto read = [&] (char& symbol) {
+            if (failed)
+                return;
+            if (position < size && IsWhitespace(source[position]))
+                position = SkipWhitespace(source, size, position);
+            if (position == size)
+                failed = true;
+            else
+                symbol = source[position++];
+        };
+
+        while (!failed && position < size)
         {
+            // Decode the whole groups of symbols up to the next whitespace
+            // at once (these are complete instructions)
+            for (xword groups = (FindWhitespace(source, size, position) - position) / 4; groups; )
+            {
+                xword count = std::min<xword>(groups, sizeof(codes));
+
+                Instruction::Decode(source + position, codes, count);
+                for (xword index = 0; index < count; ++index)
+                    builder.Append(Instruction::FromCode(codes[index]));
+                readCounter += 4 * count;
+                position += 4 * count;
+                groups -= count;
+                std::copy(source + position - 4, source + position, instructionCodeSymbols);
+            }
+            if (position == size)
+                break;
+
             // Read the symbolic code of the next instruction
             readCounter += 1;
-            stream >> instructionCodeSymbols[0]; 
-            readCounter += stream.peek() != EOF;
-            stream >> instructionCodeSymbols[1];
-            readCounter += stream.peek() != EOF;
-            stream >> instructionCodeSymbols[2];
-            readCounter += stream.peek() != EOF;
-            stream >> instructionCodeSymbols[3];
+            read(instructionCodeSymbols[0]);
+            readCounter += !failed && position < size;
+            read(instructionCodeSymbols[1]);
+            readCounter += !failed && position < size;
+            read(instructionCodeSymbols[2]);
+            readCounter += !failed && position < size;
+            read(instructionCodeSymbols[3]);
 
             // Check for insufficient symbols for the last instructions
             // This kind of error has the highest priority
             if (readCounter & 3)
-            {
-                stream.close();
                 Environment::ExitError(readCounter >> 2);
-            }
 
-            // Only keep reading for invalid file length if other type of
-            // error has been detected
-            if (hasError)
-                continue;
+            builder.Append(Instruction::GetNext(instructionCodeSymbols));
+        }
+
+        return builder.Finish(readCounter >> 2);
+    }
+
+    // Builds the table of the instruction codes (as computed by
+    // Instruction::GetNext) of the shorthand symbols; the other symbols are
+    // marked as invalid
+    constexpr std::array<byte, 256> ShorthandCodes()
+    {
+        std::array<byte, 256> codes {};
 
-            // Save the instruction and informations about brace instructions
-            // Check if a rbrace appears before a lbrace
-            instructions.push_back(Instruction::GetNext(instructionCodeSymbols));
-            if (instructions.back().Type() == Instruction::Type::Lbrace)
+        for (byte& code : codes)
+            code = invalidCode;
+        codes[(byte) Instruction::Type::Halt] = 2;
+        codes[(byte) Instruction::Type::Nop] = 0;
+        codes[(byte) Instruction::Type::Input] = 1;
+        codes[(byte) Instruction::Type::Rot] = 3;
+        codes[(byte) Instruction::Type::Swap] = 4;
+        codes[(byte) Instruction::Type::Push] = 5;
+        codes[(byte) Instruction::Type::RRot] = 9;
+        codes[(byte) Instruction::Type::Dup] = 10;
+        codes[(byte) Instruction::Type::Add] = 11;
+        codes[(byte) Instruction::Type::Lbrace] = 12;
+        codes[(byte) Instruction::Type::Output] = 13;
+        codes[(byte) Instruction::Type::Multiply] = 14;
+        codes[(byte) Instruction::Type::Execute] = 15;
+        codes[(byte) Instruction::Type::Negate] = 16;
+        codes[(byte) Instruction::Type::Pop] = 17;
+        codes[(byte) Instruction::Type::Rbrace] = 18;
+
+        return codes;
+    }
+
+    inline constexpr std::array<byte, 256> shorthandCodes = ShorthandCodes();
+
+    /**
+     * @brief Parses the instructions of a program from a span of bytes in
+     *      the shorthand form (.gsh / .glh, one symbol per instruction); an
+     *      invalid symbol is an error at its instruction index
+     */
+    INLINE std::vector<Instruction> ParseShorthand(const char* source, xword size)
+    {
+        xword readCount = 0;
+        Builder builder(size);
+
+        for (xword position = 0; position < size; ++position)
+        {
+            byte code = shorthandCodes[(byte) source[position]];
+
+            if (code == invalidCode)
             {
-                lbraceIndices.push(instructionIndex);
+                if (IsWhitespace(source[position]))
+                    continue;
+                Environment::ExitError(readCount);
             }
-            if (instructions.back().Type() == Instruction::Type::Rbrace)
+            builder.Append(Instruction::FromCode(code));
+            ++readCount;
+        }
+
+        return builder.Finish(readCount);
+    }
+
+    // Checks if the program file given to the interpreter is in the
+    // shorthand form (by its extension)
+    INLINE bool IsShorthand()
+    {
+        const char* extension = strrchr(Environment::ProgramFilename(), '.');
+
+        return extension && (!strcmp(extension, ".gsh") || !strcmp(extension, ".glh"));
+    }
+
+    // Parses the instructions of a program from a span of bytes, in the form
+    // given by the extension of the program file
+    INLINE std::vector<Instruction> Parse(const char* source, xword size)
+    {
+        return IsShorthand() ? ParseShorthand(source, size) : ParseSymbols(source, size);
+    }
+
+    /**
+     * @brief Passes the bytes of the program file given to the interpreter
+     *      (memory mapped where possible) to a function and returns its
+     *      result; a missing file is an empty program
+     */
+    template <typename F> INLINE auto WithSource(F function)
+    {
+    #if defined(__unix__)
+        int file = open(Environment::ProgramFilename(), O_RDONLY);
+        struct stat status;
+
+        if (file >= 0 && !fstat(file, &status) && S_ISREG(status.st_mode))
+        {
+            xword size = status.st_size;
+            void* source = size ? mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0) : MAP_FAILED;
+
+            if (size == 0 || source != MAP_FAILED)
             {
-                if (lbraceIndices.empty())
+                // Unmapped even if the function leaves by an exception
+                struct Mapping
                 {
-                    hasError = true;
-                    continue;
-                }
+                    void* source;
+                    xword size;
+                    ~Mapping() { if (size) munmap(source, size); }
+                } mapping { source, size };
 
-                long offset = instructionIndex - lbraceIndices.top();
-                instructions.back().Offset(-offset);
-                instructions[lbraceIndices.top()].Offset(offset + 1);
-                lbraceIndices.pop();
+                close(file);
+                return function((const char*) mapping.source, size);
             }
-            ++instructionIndex;
         }
+        if (file >= 0)
+            close(file);
+    #endif
 
-        stream.close();
-
-        // Final checks for brace errors 
-        if (hasError)
-            Environment::ExitError(instructionIndex);
-        if (!lbraceIndices.empty())
-            Environment::ExitError(readCounter >> 2);
+        std::ifstream stream(Environment::ProgramFilename(), std::ios::binary);
+        std::string source((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+        return function(source.data(), source.size());
+    }
 
-        return instructions;
+    // Parses the program file given to the interpreter
+    INLINE std::vector<Instruction> Parse()
+    {
+        return WithSource([] (const char* source, xword size) { return Parse(source, size); });
     }
 };
 
@@ -6,56 +6,768 @@
 #ifndef PROGRAM_HPP
 #define PROGRAM_HPP
 
+#include <algorithm>
+#include <functional>
+#include <queue>
 #include <vector>
 #include "Instruction.hpp"
+#include "Jit.hpp"
+#include "Loop.hpp"
+#include "Opcode.hpp"
 
 /**
  * @class Program
  * @brief Models a Glypho program as a sequence of instructions -
  *      stored as an array that can be potentially be
- *      executed in any order - and an index for the current
- *      instruction to be executed  
+ *      executed in any order
+ * @details The instructions are also compiled to a compact array of
+ *      opcodes (and their offsets) that is executed with threaded
+ *      dispatch (computed goto); the reference mode runs the
+ *      instructions through their operation pointers instead.
+ *      Common sequences of instructions are fused by a peephole pass
+ *      into superinstructions, so the positions in the optimized code
+ *      differ from the instruction indices; a side table keeps the
+ *      original index of each position (reported on exceptions) and an
+ *      unoptimized copy of the code (one opcode per instruction) follows
+ *      the optimized one: an optimized opcode that cannot run (e.g. on a
+ *      too small stack) deoptimizes, continuing in the copy from its
+ *      original index, which then faults at the exact instruction.
+ *      The innermost loops that only transform the memory in an affine
+ *      way are replaced by a single opcode running them in closed form
+ *      (deoptimizing when their conditions do not hold).
+ *      A forward pass over the code bounds the size of the memory before
+ *      each instruction (on all the paths reaching it); the instructions
+ *      whose operands are proven to be in the memory run without checking
+ *      its size, the others keeping the checks that raise the exceptions.
+ *      The threaded dispatch can also keep the top of the memory in a
+ *      local value (cached top mode).
+ *      Where supported, the optimized code can also be translated to
+ *      native code (jit mode) that returns to the threaded dispatch when
+ *      it has to deoptimize.
+ *      A run keeps its position locally, so a program can be run again
+ *      (or by several threads at once, outside the reference mode)
  */
 class Program
 {
+    /// @defgroup Friends
+    friend class Bytecode;
+
     /// @defgroup Fields
     private:
         std::vector<Instruction> instructions;
-        xword currentInstructionIndex;
+        std::vector<byte> opcodes;
+        std::vector<long> offsets;
+        std::vector<long> operands;
+        std::vector<xword> origins;
+        std::vector<Loop> loops;
+        xword baseline;
 
     /// @defgroup Constructor
     public:
-        Program(std::vector<Instruction> instructions) : instructions(instructions),
-                                                         currentInstructionIndex(0) {}
+        Program(std::vector<Instruction> instructions) : instructions(std::move(instructions))
+        {
+            Compile();
+        }
 
-    /// @defgroup Methods
-    public:
-        // Runs the program
-        void Run()
+    private:
+        Program() : baseline(0) {}
+
+    /// @defgroup Private Methods
+    private:
+        // Converts an instruction type to its opcode
+        static Opcode ToOpcode(enum Instruction::Type type)
+        {
+            switch (type)
+            {
+                case Instruction::Type::Nop:      return Opcode::Nop;
+                case Instruction::Type::Input:    return Opcode::Input;
+                case Instruction::Type::Rot:      return Opcode::Rot;
+                case Instruction::Type::Swap:     return Opcode::Swap;
+                case Instruction::Type::Push:     return Opcode::Push;
+                case Instruction::Type::RRot:     return Opcode::RRot;
+                case Instruction::Type::Dup:      return Opcode::Dup;
+                case Instruction::Type::Add:      return Opcode::Add;
+                case Instruction::Type::Lbrace:   return Opcode::Lbrace;
+                case Instruction::Type::Output:   return Opcode::Output;
+                case Instruction::Type::Multiply: return Opcode::Multiply;
+                case Instruction::Type::Execute:  return Opcode::Execute;
+                case Instruction::Type::Negate:   return Opcode::Negate;
+                case Instruction::Type::Pop:      return Opcode::Pop;
+                case Instruction::Type::Rbrace:   return Opcode::Rbrace;
+                default:                          return Opcode::Halt;
+            }
+        }
+
+        // Converts an opcode of the unoptimized code back to its instruction
+        static Instruction ToInstruction(byte opcode, long offset)
+        {
+            switch (opcode)
+            {
+                case Opcode::Nop:      return Instruction(Instruction::Type::Nop, offset, Instruction::NopOperations);
+                case Opcode::Input:    return Instruction(Instruction::Type::Input, offset, Instruction::InputOperations);
+                case Opcode::Rot:      return Instruction(Instruction::Type::Rot, offset, Instruction::RotOperations);
+                case Opcode::Swap:     return Instruction(Instruction::Type::Swap, offset, Instruction::SwapOperations);
+                case Opcode::Push:     return Instruction(Instruction::Type::Push, offset, Instruction::PushOperations);
+                case Opcode::RRot:     return Instruction(Instruction::Type::RRot, offset, Instruction::RRotOperations);
+                case Opcode::Dup:      return Instruction(Instruction::Type::Dup, offset, Instruction::DupOperations);
+                case Opcode::Add:      return Instruction(Instruction::Type::Add, offset, Instruction::AddOperations);
+                case Opcode::Lbrace:   return Instruction(Instruction::Type::Lbrace, offset, Instruction::LbraceOperations);
+                case Opcode::Output:   return Instruction(Instruction::Type::Output, offset, Instruction::OutputOperations);
+                case Opcode::Multiply: return Instruction(Instruction::Type::Multiply, offset, Instruction::MultiplyOperations);
+                case Opcode::Execute:  return Instruction(Instruction::Type::Execute, offset, Instruction::ExecuteOperations);
+                case Opcode::Negate:   return Instruction(Instruction::Type::Negate, offset, Instruction::NegateOperations);
+                case Opcode::Pop:      return Instruction(Instruction::Type::Pop, offset, Instruction::PopOperations);
+                case Opcode::Rbrace:   return Instruction(Instruction::Type::Rbrace, offset, Instruction::RbraceOperations);
+                default:               return Instruction(Instruction::Type::Halt, offset, Instruction::HaltOperations);
+            }
+        }
+
+        // Returns the number of values an instruction needs in the memory
+        static xword Requirement(byte opcode)
+        {
+            switch (opcode)
+            {
+                case Opcode::Rot:
+                case Opcode::RRot:
+                case Opcode::Dup:
+                case Opcode::Lbrace:
+                case Opcode::Output:
+                case Opcode::Negate:
+                case Opcode::Pop:      return 1;
+                case Opcode::Swap:
+                case Opcode::Add:
+                case Opcode::Multiply: return 2;
+                case Opcode::Execute:  return 4;
+                default:               return 0;
+            }
+        }
+
+        // Returns the change of the memory size made by an instruction (other
+        // than execute) that does not fail
+        static long Effect(byte opcode)
+        {
+            switch (opcode)
+            {
+                case Opcode::Input:
+                case Opcode::Push:
+                case Opcode::Dup:      return 1;
+                case Opcode::Add:
+                case Opcode::Multiply:
+                case Opcode::Output:
+                case Opcode::Pop:      return -1;
+                default:               return 0;
+            }
+        }
+
+        // Converts an instruction opcode to its variant without checks
+        static Opcode Unchecked(byte opcode)
+        {
+            switch (opcode)
+            {
+                case Opcode::Rot:      return Opcode::RotUnchecked;
+                case Opcode::Swap:     return Opcode::SwapUnchecked;
+                case Opcode::RRot:     return Opcode::RRotUnchecked;
+                case Opcode::Dup:      return Opcode::DupUnchecked;
+                case Opcode::Add:      return Opcode::AddUnchecked;
+                case Opcode::Lbrace:   return Opcode::LbraceUnchecked;
+                case Opcode::Multiply: return Opcode::MultiplyUnchecked;
+                case Opcode::Negate:   return Opcode::NegateUnchecked;
+                case Opcode::Pop:      return Opcode::PopUnchecked;
+                default:               return (Opcode) opcode;
+            }
+        }
+
+        /**
+         * @brief Returns a lower bound of the memory size before each
+         *      instruction of the unoptimized code
+         * @details The bounds are propagated along the jumps until they no
+         *      longer decrease; an instruction that does not fail had at
+         *      least the values it needs, so it is followed by its effect on
+         *      those. A loop whose bound keeps decreasing (consuming values
+         *      on each iteration) is bounded by 0, as is everything after an
+         *      execute; the unreachable instructions are bounded by 0 too
+         *      (jump gives the offset of the brace at an index)
+         */
+        template <typename Jump> static std::vector<xword> Depths(const std::vector<byte>& code, Jump jump)
+        {
+            constexpr xword unreached = ~(xword) 0;
+            std::vector<xword> depths(code.size(), unreached);
+            std::vector<byte> decreases(code.size());
+            std::vector<bool> queued(code.size());
+            std::priority_queue<xword, std::vector<xword>, std::greater<xword>> pending;
+
+            auto reach = [&] (xword index, xword depth) {
+                if (depth >= depths[index])
+                    return;
+                if (depths[index] != unreached && code[index] == Opcode::Lbrace && ++decreases[index] > 1)
+                    depth = 0;
+                depths[index] = depth;
+                if (!queued[index])
+                {
+                    queued[index] = true;
+                    pending.push(index);
+                }
+            };
+
+            reach(0, 0);
+            while (!pending.empty())
+            {
+                xword index = pending.top();
+                xword depth = std::max(depths[index], Requirement(code[index]));
+
+                pending.pop();
+                queued[index] = false;
+                switch (code[index])
+                {
+                    case Opcode::Halt:
+                    case Opcode::End:
+                        break;
+                    case Opcode::Lbrace:
+                        reach(index + 1, depth);
+                        reach(index + jump(index), depth);
+                        break;
+                    case Opcode::Rbrace:
+                        reach(index + jump(index), depth);
+                        break;
+                    case Opcode::Execute:
+                        reach(index + 1, 0);
+                        break;
+                    default:
+                        reach(index + 1, depth + Effect(code[index]));
+                        break;
+                }
+            }
+
+            for (xword& depth : depths)
+                if (depth == unreached)
+                    depth = 0;
+            return depths;
+        }
+
+        // Returns the opcode of the instruction at index, without the checks
+        // if the memory is known to hold its operands
+        static Opcode Verified(const std::vector<byte>& code, const std::vector<xword>& depths, xword index)
         {
-            long offset;
-            
-            while (currentInstructionIndex < instructions.size())
+            return depths[index] >= Requirement(code[index]) ? Unchecked(code[index]) : (Opcode) code[index];
+        }
+
+        // Appends an opcode for the instructions starting at the origin index
+        void Emit(Opcode opcode, xword origin, long offset = 0, long operand = 0)
+        {
+            opcodes.push_back(opcode);
+            offsets.push_back(offset);
+            operands.push_back(operand);
+            origins.push_back(origin);
+        }
+
+        /**
+         * @brief Returns the length of the longest run of 1 and + starting at
+         *      index that leaves a single value on the stack (its value in
+         *      value) without adding to the values below it
+         */
+        static xword ConstantLength(const std::vector<byte>& code, xword index, long& value)
+        {
+            // All the values are sums of ones, so a single value is the
+            // number of pushes
+            xword length = 0, depth = 0, pushes = 0;
+
+            for (xword end = index; ; ++end)
+            {
+                if (code[end] == Opcode::Push)
+                    ++depth, ++pushes;
+                else if (code[end] == Opcode::Add && depth >= 2)
+                    --depth;
+                else
+                    return length;
+
+                if (depth == 1)
+                {
+                    length = end - index + 1;
+                    value = pushes;
+                }
+            }
+        }
+
+        // Emits a CountedLoop opcode for the loop between the braces at index and
+        // end if it can run in closed form
+        bool AnalyzeLoop(const byte* code, xword index, xword end)
+        {
+            Loop loop;
+
+            if (!Loop::Analyze(code, index, end, loop))
+                return false;
+
+            Emit(Opcode::CountedLoop, index, 0, loops.size());
+            loops.push_back(std::move(loop));
+            return true;
+        }
+
+        // Rebuilds the loops of a program loaded in compiled form (from its
+        // unoptimized code); returns false if a loop opcode does not match the
+        // loop it was compiled from
+        bool AnalyzeLoops()
+        {
+            const byte* code = opcodes.data() + baseline;
+
+            for (xword position = 0; position < baseline; ++position)
+                if (opcodes[position] == Opcode::CountedLoop)
+                {
+                    xword index = origins[position];
+                    Loop loop;
+
+                    if (operands[position] != (long) loops.size() || code[index] != Opcode::Lbrace ||
+                        !Loop::Analyze(code, index, index + offsets[baseline + index] - 1, loop))
+                        return false;
+                    loops.push_back(std::move(loop));
+                }
+            return true;
+        }
+
+        /**
+         * @brief Emits the optimized opcode for the instructions starting at
+         *      index (fusing common sequences into superinstructions) and
+         *      returns the number of instructions it covers
+         */
+        xword Optimize(const std::vector<byte>& code, const std::vector<xword>& depths, xword index)
+        {
+            xword length = 1, end;
+            long value = 0;
+
+            switch (code[index])
+            {
+                case Opcode::Lbrace:
+                    end = index + instructions[index].Offset() - 1;
+                    if (AnalyzeLoop(code.data(), index, end))
+                        return end - index + 1;
+                    Emit(Verified(code, depths, index), index);
+                    return 1;
+
+                case Opcode::Nop:
+                    for (end = index; code[end] == Opcode::Nop; ++end);
+                    Emit(Opcode::Nop, index);
+                    return end - index;
+
+                case Opcode::Push:
+                    length = ConstantLength(code, index, value);
+                    end = index + length;
+                    if (code[end] == Opcode::Add)
+                        Emit(Opcode::AddConstant, index, 0, value), ++length;
+                    else if (code[end] == Opcode::Negate && code[end + 1] == Opcode::Add)
+                        Emit(Opcode::AddConstant, index, 0, -value), length += 2;
+                    else if (length > 1)
+                        Emit(Opcode::PushConstant, index, 0, value);
+                    else
+                        Emit(Opcode::Push, index);
+                    return length;
+
+                case Opcode::Dup:
+                    if (code[index + 1] == Opcode::Multiply)
+                        Emit(Opcode::Square, index), length = 2;
+                    else if (code[index + 1] == Opcode::Add)
+                        Emit(Opcode::Double, index), length = 2;
+                    else
+                        Emit(Verified(code, depths, index), index);
+                    return length;
+
+                case Opcode::Rot:
+                case Opcode::RRot:
+                    value = 0;
+                    for (end = index; code[end] == Opcode::Rot || code[end] == Opcode::RRot; ++end)
+                        value += code[end] == Opcode::Rot ? 1 : -1;
+                    if (end - index > 1)
+                        Emit(Opcode::Rotate, index, 0, value);
+                    else
+                        Emit(Verified(code, depths, index), index);
+                    return end - index;
+
+                default:
+                    Emit(Verified(code, depths, index), index);
+                    return 1;
+            }
+        }
+
+        /**
+         * @brief Builds the optimized code followed by the unoptimized one,
+         *      each ended by an End opcode; the braces of the optimized code
+         *      jump to the positions of their original targets (the braces
+         *      are never fused, so each target starts an optimized opcode)
+         */
+        void Compile()
+        {
+            std::vector<byte> code;
+            std::vector<xword> positions(instructions.size() + 1);
+
+            code.reserve(instructions.size() + 1);
+            opcodes.reserve(2 * instructions.size() + 2);
+            offsets.reserve(2 * instructions.size() + 2);
+            operands.reserve(2 * instructions.size() + 2);
+            origins.reserve(2 * instructions.size() + 2);
+            for (const Instruction& instruction : instructions)
+                code.push_back(ToOpcode(instruction.Type()));
+            code.push_back(Opcode::End);
+
+            std::vector<xword> depths = Depths(code, [&] (xword index) { return instructions[index].Offset(); });
+            for (xword index = 0; index < instructions.size(); )
+            {
+                positions[index] = opcodes.size();
+                index += Optimize(code, depths, index);
+            }
+            positions[instructions.size()] = opcodes.size();
+            Emit(Opcode::End, instructions.size());
+
+            for (xword position = 0; position < opcodes.size(); ++position)
+                if (opcodes[position] == Opcode::Lbrace || opcodes[position] == Opcode::LbraceUnchecked ||
+                    opcodes[position] == Opcode::Rbrace)
+                {
+                    xword target = origins[position] + instructions[origins[position]].Offset();
+                    offsets[position] = positions[target] - position;
+                }
+
+            baseline = opcodes.size();
+            for (xword index = 0; index < instructions.size(); ++index)
+                Emit((Opcode) code[index], index, instructions[index].Offset());
+            Emit(Opcode::End, instructions.size());
+        }
+
+        // Rebuilds the instructions from the unoptimized code (for a program
+        // loaded in compiled form)
+        void Decompile()
+        {
+            for (xword index = instructions.size(); baseline + index + 1 < opcodes.size(); ++index)
+                instructions.push_back(ToInstruction(opcodes[baseline + index], offsets[baseline + index]));
+        }
+
+        // Runs the instructions one by one through their operations
+        void RunReference()
+        {
+            xword index = 0;
+
+            Decompile();
+
+            while (index < instructions.size())
             {
                 try
                 {
-                    offset = instructions[currentInstructionIndex]();
-                    currentInstructionIndex += offset;
+                    index += instructions[index]();
+                }
+                catch (const Environment::Exit&)
+                {
+                    throw;
                 }
                 catch (...)
                 {
-                    Environment::ExitException(currentInstructionIndex);
+                    Environment::ExitException(index);
                 }
             }
         }
 
+        // Runs the opcodes with threaded dispatch; a single exception handler
+        // covers the whole loop, reporting the origin of the current opcode
+        void RunThreaded(xword index = 0)
+        {
+            static const void* const labels[] = {
+                &&halt, &&nop, &&input, &&rot, &&swap, &&push, &&rrot, &&dup,
+                &&add, &&lbrace, &&output, &&multiply, &&execute, &&negate, &&pop, &&rbrace,
+                &&end,
+                &&pushConstant, &&addConstant, &&square, &&twice, &&rotate, &&countedLoop,
+                &&rotUnchecked, &&swapUnchecked, &&rrotUnchecked, &&dupUnchecked,
+                &&addUnchecked, &&lbraceUnchecked, &&multiplyUnchecked, &&negateUnchecked, &&popUnchecked
+            };
+            const byte* opcodes = this->opcodes.data();
+            const long* offsets = this->offsets.data();
+            const long* operands = this->operands.data();
+            const xword* origins = this->origins.data();
+            const Loop* loops = this->loops.data();
+
+            #define DISPATCH(step) do { index += (step); goto *labels[opcodes[index]]; } while (0)
+            #define DEOPTIMIZE() do { index = baseline + origins[index]; goto *labels[opcodes[index]]; } while (0)
+
+            try
+            {
+                goto *labels[opcodes[index]];
+
+                halt:     Instruction::HaltOperations(0);
+                nop:      DISPATCH(1);
+                input:    Instruction::InputOperations(0);    DISPATCH(1);
+                rot:      Instruction::RotOperations(0);      DISPATCH(1);
+                swap:     Instruction::SwapOperations(0);     DISPATCH(1);
+                push:     Instruction::PushOperations(0);     DISPATCH(1);
+                rrot:     Instruction::RRotOperations(0);     DISPATCH(1);
+                dup:      Instruction::DupOperations(0);      DISPATCH(1);
+                add:      Instruction::AddOperations(0);      DISPATCH(1);
+                lbrace:   DISPATCH(Instruction::LbraceOperations(offsets[index]));
+                output:   Instruction::OutputOperations(0);   DISPATCH(1);
+                multiply: Instruction::MultiplyOperations(0); DISPATCH(1);
+                execute:  DISPATCH(Instruction::ExecuteOperations(0));
+                negate:   Instruction::NegateOperations(0);   DISPATCH(1);
+                pop:      Instruction::PopOperations(0);      DISPATCH(1);
+                rbrace:   DISPATCH(offsets[index]);
+                end:      return;
+
+                // Superinstructions check their preconditions before any
+                // side effect and deoptimize when these do not hold
+                pushConstant:
+                    Memory::Push(Integer(std::abs(operands[index]), operands[index] < 0));
+                    DISPATCH(1);
+                addConstant:
+                    if (Memory::Size() == 0)
+                        DEOPTIMIZE();
+                    Memory::At(0) += Integer(std::abs(operands[index]), operands[index] < 0);
+                    DISPATCH(1);
+                square:
+                    if (Memory::Size() == 0)
+                        DEOPTIMIZE();
+                    Memory::At(0) *= Memory::At(0);
+                    DISPATCH(1);
+                twice:
+                    if (Memory::Size() == 0)
+                        DEOPTIMIZE();
+                    Memory::At(0) += Memory::At(0);
+                    DISPATCH(1);
+                rotate:
+                    if (Memory::Size() == 0)
+                        DEOPTIMIZE();
+                    Memory::Rotate(operands[index]);
+                    DISPATCH(1);
+                countedLoop:
+                    if (!loops[operands[index]].Run())
+                        DEOPTIMIZE();
+                    DISPATCH(1);
+
+                // The memory holds the operands of the unchecked instructions
+                rotUnchecked:      Memory::ShiftUp<false>();       DISPATCH(1);
+                swapUnchecked:     Memory::SwapTop<false>();       DISPATCH(1);
+                rrotUnchecked:     Memory::ShiftDown<false>();     DISPATCH(1);
+                dupUnchecked:      Memory::DuplicateTop<false>();  DISPATCH(1);
+                addUnchecked:      Memory::At(1) += Memory::At(0); Memory::RemoveTop<false>(); DISPATCH(1);
+                lbraceUnchecked:   DISPATCH(Memory::At(0).IsZero() ? offsets[index] : 1);
+                multiplyUnchecked: Memory::At(1) *= Memory::At(0); Memory::RemoveTop<false>(); DISPATCH(1);
+                negateUnchecked:   Memory::At(0).Negate();         DISPATCH(1);
+                popUnchecked:      Memory::RemoveTop<false>();     DISPATCH(1);
+            }
+            catch (const Environment::Exit&)
+            {
+                throw;
+            }
+            catch (...)
+            {
+                Environment::ExitException(origins[index]);
+            }
+
+            #undef DEOPTIMIZE
+            #undef DISPATCH
+        }
+
+        /**
+         * @brief Runs the opcodes with threaded dispatch, keeping the top of
+         *      the memory in a local value while it is produced and consumed
+         *      by consecutive operations
+         * @details The top is either cached (the memory holding the values
+         *      below it) or in the memory: pushes and the operations on the
+         *      top values work on the cached one in place, pops only drop it,
+         *      and it is spilled to the memory before the opcodes reaching
+         *      deeper into it (rotations, execute and the loops run in closed
+         *      form). The checks of the memory size count the cached top, so
+         *      the same exceptions are raised
+         */
+        void RunCachedTop(xword index = 0)
+        {
+            static const void* const labels[] = {
+                &&halt, &&nop, &&input, &&rot, &&swap, &&push, &&rrot, &&dup,
+                &&add, &&lbrace, &&output, &&multiply, &&execute, &&negate, &&pop, &&rbrace,
+                &&end,
+                &&pushConstant, &&addConstant, &&square, &&twice, &&rotate, &&countedLoop,
+                &&rotUnchecked, &&swapUnchecked, &&rrotUnchecked, &&dupUnchecked,
+                &&addUnchecked, &&lbraceUnchecked, &&multiplyUnchecked, &&negateUnchecked, &&popUnchecked
+            };
+            const byte* opcodes = this->opcodes.data();
+            const long* offsets = this->offsets.data();
+            const long* operands = this->operands.data();
+            const xword* origins = this->origins.data();
+            const Loop* loops = this->loops.data();
+            Integer top(0);
+            bool cached = false;
+
+            #define DISPATCH(step) do { index += (step); goto *labels[opcodes[index]]; } while (0)
+            #define DEOPTIMIZE() do { index = baseline + origins[index]; goto *labels[opcodes[index]]; } while (0)
+            #define SPILL() do { if (cached) Memory::Push(std::move(top)), cached = false; } while (0)
+            #define PUSH(value) do { if (cached) Memory::Push(std::move(top)); top = (value); cached = true; } while (0)
+            #define TOP() (cached ? top : Memory::Peek())
+            #define REQUIRE(count) do { if (Memory::Size() + cached < (count)) throw 0; } while (0)
+
+            // Combines the two top values into one (into the cached top, as
+            // the operations are commutative)
+            #define COMBINE(operation) do {                                           \
+                if (cached)                                                           \
+                    top operation Memory::At(0);                                      \
+                else                                                                  \
+                    Memory::At(1) operation Memory::At(0);                            \
+                Memory::RemoveTop<false>();                                           \
+            } while (0)
+
+            try
+            {
+                goto *labels[opcodes[index]];
+
+                halt:     Instruction::HaltOperations(0);
+                nop:      DISPATCH(1);
+                input:    PUSH(Integer(Input::Next(), Environment::Base())); DISPATCH(1);
+                rot:      SPILL(); Memory::ShiftUp();                        DISPATCH(1);
+                swap:     REQUIRE(2);
+                          if (cached)
+                              top.Swap(Memory::At(0));
+                          else
+                              Memory::SwapTop<false>();
+                          DISPATCH(1);
+                push:     PUSH(Integer(1));                                  DISPATCH(1);
+                rrot:     SPILL(); Memory::ShiftDown();                      DISPATCH(1);
+                dup:      REQUIRE(1);
+                          if (cached)
+                              Memory::Push(top);
+                          else
+                              top = Memory::At(0), cached = true;
+                          DISPATCH(1);
+                add:      REQUIRE(2); COMBINE(+=);                           DISPATCH(1);
+                lbrace:   REQUIRE(1); DISPATCH(TOP().IsZero() ? offsets[index] : 1);
+                output:   REQUIRE(1);
+                          if (cached)
+                          {
+                              Output::Write(std::move(top), Environment::Base());
+                              cached = false;
+                          }
+                          else
+                          {
+                              Output::Write(std::move(Memory::At(0)), Environment::Base());
+                              Memory::RemoveTop<false>();
+                          }
+                          DISPATCH(1);
+                multiply: REQUIRE(2); COMBINE(*=);                           DISPATCH(1);
+                execute:  SPILL(); DISPATCH(Instruction::ExecuteOperations(0));
+                negate:   REQUIRE(1); TOP().Negate();                        DISPATCH(1);
+                pop:      REQUIRE(1);
+                          if (cached)
+                              cached = false;
+                          else
+                              Memory::RemoveTop<false>();
+                          DISPATCH(1);
+                rbrace:   DISPATCH(offsets[index]);
+                end:      SPILL();
+                          return;
+
+                pushConstant:
+                    PUSH(Integer(std::abs(operands[index]), operands[index] < 0));
+                    DISPATCH(1);
+                addConstant:
+                    if (Memory::Size() + cached == 0)
+                        DEOPTIMIZE();
+                    TOP() += Integer(std::abs(operands[index]), operands[index] < 0);
+                    DISPATCH(1);
+                square:
+                    if (Memory::Size() + cached == 0)
+                        DEOPTIMIZE();
+                    TOP() *= TOP();
+                    DISPATCH(1);
+                twice:
+                    if (Memory::Size() + cached == 0)
+                        DEOPTIMIZE();
+                    TOP() += TOP();
+                    DISPATCH(1);
+                rotate:
+                    if (Memory::Size() + cached == 0)
+                        DEOPTIMIZE();
+                    SPILL();
+                    Memory::Rotate(operands[index]);
+                    DISPATCH(1);
+                countedLoop:
+                    SPILL();
+                    if (!loops[operands[index]].Run())
+                        DEOPTIMIZE();
+                    DISPATCH(1);
+
+                rotUnchecked:      SPILL(); Memory::ShiftUp<false>();   DISPATCH(1);
+                swapUnchecked:     if (cached)
+                                       top.Swap(Memory::At(0));
+                                   else
+                                       Memory::SwapTop<false>();
+                                   DISPATCH(1);
+                rrotUnchecked:     SPILL(); Memory::ShiftDown<false>(); DISPATCH(1);
+                dupUnchecked:      if (cached)
+                                       Memory::Push(top);
+                                   else
+                                       top = Memory::At(0), cached = true;
+                                   DISPATCH(1);
+                addUnchecked:      COMBINE(+=);                         DISPATCH(1);
+                lbraceUnchecked:   DISPATCH(TOP().IsZero() ? offsets[index] : 1);
+                multiplyUnchecked: COMBINE(*=);                         DISPATCH(1);
+                negateUnchecked:   TOP().Negate();                      DISPATCH(1);
+                popUnchecked:      if (cached)
+                                       cached = false;
+                                   else
+                                       Memory::RemoveTop<false>();
+                                   DISPATCH(1);
+            }
+            catch (const Environment::Exit&)
+            {
+                throw;
+            }
+            catch (...)
+            {
+                Environment::ExitException(origins[index]);
+            }
+
+            #undef COMBINE
+            #undef REQUIRE
+            #undef TOP
+            #undef PUSH
+            #undef SPILL
+            #undef DEOPTIMIZE
+            #undef DISPATCH
+        }
+
+        // Runs the optimized code translated to native code, falling back to
+        // threaded dispatch if the translation is not possible
+        void RunNative()
+        {
+        #if defined(GLYPHO_JIT)
+            Jit jit(opcodes.data(), offsets.data(), operands.data(), loops.data(), baseline);
+
+            if (jit.Compiled())
+            {
+                xword result = jit(), position = result >> 2;
+
+                if ((result & 3) == Jit::Status::Exception)
+                    Environment::ExitException(origins[position]);
+                if ((result & 3) == Jit::Status::Deoptimize)
+                    RunThreaded(baseline + origins[position]);
+                return;
+            }
+        #endif
+            RunThreaded();
+        }
+
+    /// @defgroup Methods
+    public:
+        // Runs the program (the contained runs exit by exceptions, which cannot
+        // unwind through native code, so they are never jit compiled)
+        void Run()
+        {
+            if (Environment::Reference())
+                RunReference();
+            else if (Environment::Native() && !Environment::Contained())
+                RunNative();
+            else if (Environment::CachedTop())
+                RunCachedTop();
+            else
+                RunThreaded();
+        }
+
         // Converts the program to a .glh symbolic representation
         std::string ToString() const
         {
             std::string string;
 
-            for (xword i = 0; i < instructions.size(); ++i)
-                string.push_back((char) instructions[i].Type());
+            for (xword i = baseline; i + 1 < opcodes.size(); ++i)
+                string.push_back((char) ToInstruction(opcodes[i], 0).Type());
 
             return string;
         }
@@ -0,0 +1,408 @@
+/// ============================
+/// @author Andrei Biu - Pislaru
+/// @brief Implementation of RadixOps "static" class
+/// ============================
+
+#ifndef RADIX_OPS_HPP
+#define RADIX_OPS_HPP
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "Utils.hpp"
+#include "LimbOps.hpp"
+
+#ifndef GLYPHO_CONVERSION_THRESHOLD
+#define GLYPHO_CONVERSION_THRESHOLD 30
+#endif
+
+/**
+ * @class RadixOps
+ * @brief Contains the conversions between raw arrays of xword limbs and
+ *        their string representations in bases 2 - 36
+ * @details Power of two bases are converted by extracting (or packing) the
+ *          bits of each digit directly; for the other bases the limbs are
+ *          processed in chunks of k digits (base^k being the biggest power
+ *          of the base that fits in a limb) and, above a tunable width, the
+ *          number is split recursively by the powers base^(k * 2^i)
+ *          (divide and conquer) in both directions
+ * @note All members are static to simplify the singleton pattern
+ */
+class RadixOps
+{
+    /// @defgroup Static Fields
+    private:
+        static xword conversionThreshold;
+
+    /// @defgroup Static Getters & Setters
+    public:
+        static xword ConversionThreshold();
+        static void ConversionThreshold(xword threshold);
+
+    /// @defgroup Private Static Methods
+    private:
+        static xword BitsPerDigit(byte base);
+        static xword DigitsPerLimb(byte base, xword& power);
+        static void WriteChunk(char* end, xword value, xword digits, byte base);
+        static void ToStringPowerOfTwo(char* string, const xword* limbs, xword width, xword digits, byte base);
+        static void ToStringBasecase(char* end, const xword* limbs, xword width, xword digits, byte base);
+        static void ToStringRecursive(char* end, const xword* limbs, xword width, xword digits, byte base,
+                                      const std::vector<std::vector<xword>>& powers);
+        static std::vector<std::vector<xword>> Powers(byte base, xword digits);
+        static xword ReadChunk(const char* digits, xword count, byte base);
+        static xword FromStringPowerOfTwo(xword* limbs, const char* digits, xword length, byte base);
+        static xword FromStringBasecase(xword* limbs, const char* digits, xword length, byte base);
+        static xword FromStringRecursive(xword* limbs, const char* digits, xword length, byte base,
+                                         const std::vector<std::vector<xword>>& powers);
+
+    /// @defgroup Public Static Methods
+    public:
+        static xword ToStringLength(const xword* limbs, xword width, byte base);
+        static xword ToString(char* string, const xword* limbs, xword width, byte base);
+        static std::string ToString(const xword* limbs, xword width, byte base);
+        static xword FromStringWidth(xword length, byte base);
+        static xword FromString(xword* limbs, const char* digits, xword length, byte base);
+};
+
+
+/// @ingroup Static Fields
+inline xword RadixOps::conversionThreshold = GLYPHO_CONVERSION_THRESHOLD;
+
+/// @ingroup Static Getters & Setters
+/// @{
+INLINE xword RadixOps::ConversionThreshold() { return conversionThreshold; }
+INLINE void RadixOps::ConversionThreshold(xword threshold) { conversionThreshold = std::max<xword>(threshold, 2); }
+/// @}
+
+/// @ingroup Private Static Methods
+/// @{
+
+// Returns log2(base) for power of two bases and 0 otherwise
+INLINE xword RadixOps::BitsPerDigit(byte base)
+{
+    return (base & (base - 1)) ? 0 : ArithmeticOps::Log2Floor(base);
+}
+
+// Returns the biggest k such that base^k fits in a limb (and base^k in power)
+INLINE xword RadixOps::DigitsPerLimb(byte base, xword& power)
+{
+    xword digits = 1;
+
+    power = base;
+    while (power <= (xword) -1 / base)
+    {
+        power *= base;
+        ++digits;
+    }
+
+    return digits;
+}
+
+// Writes exactly digits characters (zero padded) ending before end
+INLINE void RadixOps::WriteChunk(char* end, xword value, xword digits, byte base)
+{
+    while (digits--)
+    {
+        *--end = Utils::ToDigit(value % base);
+        value /= base;
+    }
+}
+
+// Writes exactly digits characters (all the digits of the number)
+void RadixOps::ToStringPowerOfTwo(char* string, const xword* limbs, xword width, xword digits, byte base)
+{
+    constexpr xword bits = sizeof(xword) * 8;
+    xword bitsPerDigit = BitsPerDigit(base), mask = base - 1;
+
+    for (xword digit = 0, offset = 0; digit < digits; ++digit, offset += bitsPerDigit)
+    {
+        xword index = offset / bits, shift = offset % bits, value = limbs[index] >> shift;
+        if (shift + bitsPerDigit > bits && index + 1 < width)
+            value |= limbs[index + 1] << (bits - shift);
+        string[digits - 1 - digit] = Utils::ToDigit(value & mask);
+    }
+}
+
+/**
+ * @brief Writes exactly digits characters (zero padded, a multiple of the
+ *      digits per limb) ending before end by repeatedly dividing a copy of
+ *      the limbs by the biggest power of the base that fits in a limb
+ */
+void RadixOps::ToStringBasecase(char* end, const xword* limbs, xword width, xword digits, byte base)
+{
+    xword power, digitsPerLimb = DigitsPerLimb(base, power);
+    xword* number = (xword*) malloc(width * sizeof(xword));
+
+    memcpy(number, limbs, width * sizeof(xword));
+    while (digits && (width > 1 || number[0]))
+    {
+        WriteChunk(end, LimbOps::Divide(number, number, width, power), digitsPerLimb, base);
+        width -= width > 1 && number[width - 1] == 0;
+        end -= digitsPerLimb;
+        digits -= digitsPerLimb;
+    }
+    memset(end - digits, '0', digits);
+
+    free(number);
+}
+
+/**
+ * @brief Writes exactly digits characters (zero padded, a multiple of the
+ *      digits per limb) ending before end; the number is split into a high
+ *      and a low part by the biggest power base^(k * 2^i) that has less
+ *      digits than required
+ */
+void RadixOps::ToStringRecursive(char* end, const xword* limbs, xword width, xword digits, byte base,
+                                 const std::vector<std::vector<xword>>& powers)
+{
+    xword power, digitsPerLimb = DigitsPerLimb(base, power), level = powers.size() - 1;
+
+    while (width > 1 && limbs[width - 1] == 0)
+        --width;
+    if (width < conversionThreshold)
+    {
+        ToStringBasecase(end, limbs, width, digits, base);
+        return;
+    }
+
+    while (level && (digitsPerLimb << level) >= digits)
+        --level;
+
+    const std::vector<xword>& divisor = powers[level];
+    xword lowDigits = digitsPerLimb << level;
+
+    if (width < divisor.size())
+    {
+        memset(end - digits, '0', digits - lowDigits);
+        ToStringRecursive(end, limbs, width, lowDigits, base, powers);
+    }
+    else
+    {
+        xword* buffer = (xword*) malloc((width + 1) * sizeof(xword));
+        xword *quotient = buffer, *remainder = buffer + width - divisor.size() + 1;
+
+        LimbOps::Divide(quotient, remainder, limbs, width, divisor.data(), divisor.size());
+        ToStringRecursive(end, remainder, divisor.size(), lowDigits, base, powers);
+        ToStringRecursive(end - lowDigits, quotient, width - divisor.size() + 1,
+                          digits - lowDigits, base, powers);
+
+        free(buffer);
+    }
+}
+
+// Returns the powers base^(k * 2^i) that have less than the given digits
+std::vector<std::vector<xword>> RadixOps::Powers(byte base, xword digits)
+{
+    xword power, digitsPerLimb = DigitsPerLimb(base, power);
+    std::vector<std::vector<xword>> powers = { { power } };
+
+    while ((digitsPerLimb << powers.size()) < digits)
+    {
+        const std::vector<xword>& last = powers.back();
+        std::vector<xword> square(last.size() << 1);
+        LimbOps::Square(square.data(), last.data(), last.size());
+        if (square.back() == 0)
+            square.pop_back();
+        powers.push_back(std::move(square));
+    }
+
+    return powers;
+}
+
+// Horner's scheme for a chunk of digits that fits in a limb
+INLINE xword RadixOps::ReadChunk(const char* digits, xword count, byte base)
+{
+    xword value = 0;
+
+    while (count--)
+        value = value * base + Utils::ToNumber(*digits++);
+
+    return value;
+}
+
+xword RadixOps::FromStringPowerOfTwo(xword* limbs, const char* digits, xword length, byte base)
+{
+    constexpr xword bits = sizeof(xword) * 8;
+    xword bitsPerDigit = BitsPerDigit(base),
+          width = (length * bitsPerDigit + bits - 1) / bits;
+
+    std::fill(limbs, limbs + width, 0);
+    for (xword digit = 0, offset = 0; digit < length; ++digit, offset += bitsPerDigit)
+    {
+        xword index = offset / bits, shift = offset % bits, value = Utils::ToNumber(digits[length - 1 - digit]);
+        limbs[index] |= value << shift;
+        if (shift + bitsPerDigit > bits)
+            limbs[index + 1] |= value >> (bits - shift);
+    }
+
+    while (width > 1 && limbs[width - 1] == 0)
+        --width;
+    return width;
+}
+
+// Horner's scheme over chunks of digits (multiplication by base^k per chunk)
+xword RadixOps::FromStringBasecase(xword* limbs, const char* digits, xword length, byte base)
+{
+    xword power, digitsPerLimb = DigitsPerLimb(base, power), width = 1,
+          count = length % digitsPerLimb ? length % digitsPerLimb : digitsPerLimb;
+
+    limbs[0] = ReadChunk(digits, count, base);
+    for (digits += count, length -= count; length; digits += digitsPerLimb, length -= digitsPerLimb)
+    {
+        xword chunk = ReadChunk(digits, digitsPerLimb, base);
+        limbs[width] = LimbOps::Multiply(limbs, limbs, width, power);
+        limbs[width] += LimbOps::AddInPlace(limbs, width, &chunk, 1);
+        width += limbs[width] != 0;
+    }
+
+    return width;
+}
+
+/**
+ * @brief Converts the digits as high * base^(k * 2^i) + low, the low part
+ *      having k * 2^i digits (the biggest power that has less digits than
+ *      the string), converting each part recursively
+ */
+xword RadixOps::FromStringRecursive(xword* limbs, const char* digits, xword length, byte base,
+                                    const std::vector<std::vector<xword>>& powers)
+{
+    xword power, digitsPerLimb = DigitsPerLimb(base, power), level = powers.size() - 1;
+
+    if (length / digitsPerLimb < conversionThreshold)
+        return FromStringBasecase(limbs, digits, length, base);
+
+    while (level && (digitsPerLimb << level) >= length)
+        --level;
+
+    const std::vector<xword>& multiplier = powers[level];
+    xword lowDigits = digitsPerLimb << level, highDigits = length - lowDigits,
+          highWidth, lowWidth, width;
+    xword *high = (xword*) malloc(FromStringWidth(highDigits, base) * sizeof(xword)),
+          *low = (xword*) malloc(FromStringWidth(lowDigits, base) * sizeof(xword)),
+          *product;
+
+    highWidth = FromStringRecursive(high, digits, highDigits, base, powers);
+    lowWidth = FromStringRecursive(low, digits + highDigits, lowDigits, base, powers);
+
+    width = highWidth + multiplier.size();
+    product = (xword*) malloc(width * sizeof(xword));
+    if (highWidth >= multiplier.size())
+        LimbOps::Multiply(product, high, highWidth, multiplier.data(), multiplier.size());
+    else
+        LimbOps::Multiply(product, multiplier.data(), multiplier.size(), high, highWidth);
+    LimbOps::AddInPlace(product, width, low, lowWidth);
+    while (width > 1 && product[width - 1] == 0)
+        --width;
+    memcpy(limbs, product, width * sizeof(xword));
+
+    free(product);
+    free(low);
+    free(high);
+    return width;
+}
+
+/// @}
+
+/// @ingroup Public Static Methods
+/// @{
+
+/**
+ * @brief Upper bound for the number of digits of a non-zero limb array
+ *      (without leading zero limbs) in the given base; exact for the power
+ *      of two bases and rounded up to a multiple of the digits per limb for
+ *      the others
+ */
+INLINE xword RadixOps::ToStringLength(const xword* limbs, xword width, byte base)
+{
+    constexpr xword bits = sizeof(xword) * 8;
+    xword totalBits = (width - 1) * bits + ArithmeticOps::Log2Floor(limbs[width - 1]) + 1;
+
+    if (xword bitsPerDigit = BitsPerDigit(base))
+        return (totalBits + bitsPerDigit - 1) / bitsPerDigit;
+
+    xword power, digitsPerLimb = DigitsPerLimb(base, power),
+          digits = (xword) (totalBits / std::log2(base)) + 2;
+    return (digits + digitsPerLimb - 1) / digitsPerLimb * digitsPerLimb;
+}
+
+/**
+ * @brief Writes the digits of a non-zero limb array (without leading zero
+ *      limbs) in the given base to string (with room for at least
+ *      ToStringLength digits) and returns their count
+ */
+xword RadixOps::ToString(char* string, const xword* limbs, xword width, byte base)
+{
+    xword digits = ToStringLength(limbs, width, base), length;
+
+    if (BitsPerDigit(base))
+    {
+        ToStringPowerOfTwo(string, limbs, width, digits, base);
+        return digits;
+    }
+
+    // Single limbs are written directly, from the last digit
+    if (width == 1)
+    {
+        char* end = string + digits;
+        for (xword value = limbs[0]; value; value /= base)
+            *--end = Utils::ToDigit(value % base);
+        length = string + digits - end;
+        memmove(string, end, length);
+        return length;
+    }
+
+    if (width < conversionThreshold)
+    {
+        ToStringBasecase(string + digits, limbs, width, digits, base);
+    }
+    else
+    {
+        ToStringRecursive(string + digits, limbs, width, digits, base, Powers(base, digits));
+    }
+
+    for (length = digits; length > 1 && string[digits - length] == '0'; --length);
+    memmove(string, string + digits - length, length);
+    return length;
+}
+
+/**
+ * @brief Converts a non-zero limb array (without leading zero limbs) to its
+ *      string representation in the given base
+ */
+std::string RadixOps::ToString(const xword* limbs, xword width, byte base)
+{
+    std::string string(ToStringLength(limbs, width, base), '0');
+
+    string.resize(ToString(string.data(), limbs, width, base));
+    return string;
+}
+
+/// @brief Upper bound for the number of limbs of a number with length digits
+INLINE xword RadixOps::FromStringWidth(xword length, byte base)
+{
+    return length * ArithmeticOps::Log2Ceil(base) / (sizeof(xword) * 8) + 2;
+}
+
+/**
+ * @brief Converts a string of valid digits (without sign) to limbs (at least
+ *      FromStringWidth(length, base) of them) and returns the width of the
+ *      number (without leading zero limbs)
+ */
+xword RadixOps::FromString(xword* limbs, const char* digits, xword length, byte base)
+{
+    if (BitsPerDigit(base))
+        return FromStringPowerOfTwo(limbs, digits, length, base);
+
+    xword power, digitsPerLimb = DigitsPerLimb(base, power);
+
+    if (length / digitsPerLimb < conversionThreshold)
+        return FromStringBasecase(limbs, digits, length, base);
+    return FromStringRecursive(limbs, digits, length, base, Powers(base, length));
+}
+
+/// @}
+
+#endif  // RADIX_OPS_HPP
@@ -0,0 +1,439 @@
+/// ============================
+/// @author Andrei Biu - Pislaru
+/// @brief Implementation of Server "static" class
+/// ============================
+
+#ifndef SERVER_HPP
+#define SERVER_HPP
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#if defined(__unix__)
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include "Bytecode.hpp"
+#include "Environment.hpp"
+#include "Input.hpp"
+#include "Memory.hpp"
+#include "Output.hpp"
+#include "Parser.hpp"
+#include "Program.hpp"
+
+#ifndef GLYPHO_SERVER_CACHE
+#define GLYPHO_SERVER_CACHE 64
+#endif
+
+/**
+ * @class Server
+ * @brief Runs programs for local clients (glypho-client) over a Unix domain
+ *        socket, keeping the compiled programs in memory between requests
+ * @details A request starts with a header: the checksum of the source (as
+ *          the one of the bytecode cache), its size and form, the base and
+ *          the size of the input. The server answers whether it has the
+ *          program (looked up by checksum, size and form); only if it does
+ *          not is the source sent (and compiled, then cached). Then the input
+ *          is sent whole and the output streamed back in blocks (each one
+ *          prefixed by its size), ended by an empty block and the exit status
+ *          (with the index of the faulting instruction). The compiled
+ *          programs are kept in a least recently used cache of
+ *          GLYPHO_SERVER_CACHE programs. There are as many workers (each
+ *          one accepting and serving a connection at a time) as hardware
+ *          threads, unless given by the GLYPHO_SERVER_WORKERS environment
+ *          variable. The client reads the socket path from GLYPHO_SOCKET
+ *          (defaulting to the one in socketPath)
+ */
+class Server
+{
+    /// @defgroup Nested Types
+    private:
+        struct Request
+        {
+            xword checksum;
+            xword sourceSize;
+            xword shorthand;
+            xword base;
+            xword inputSize;
+        };
+
+        struct Reply
+        {
+            long status;
+            xword index;
+        };
+
+        // The programs are identified by their checksum, size and form
+        struct Key
+        {
+            xword checksum;
+            xword size;
+            bool shorthand;
+
+            bool operator == (const Key& key) const
+            {
+                return checksum == key.checksum && size == key.size && shorthand == key.shorthand;
+            }
+        };
+
+        struct KeyHash
+        {
+            xword operator () (const Key& key) const { return key.checksum ^ key.size ^ key.shorthand; }
+        };
+
+        using Entry = std::pair<Key, std::shared_ptr<Program>>;
+
+        // The connection of a run, closed once a send to its client fails
+        struct Stream
+        {
+            int socket;
+            bool closed;
+        };
+
+    /// @defgroup Static Fields
+    public:
+        static constexpr const char* socketPath = "/tmp/glypho.sock";
+
+    private:
+        static std::mutex mutex;
+        static std::list<Entry> entries;        // the most recently used first
+        static std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> programs;
+
+    /// @defgroup Private Static Methods
+    private:
+        static std::shared_ptr<Program> Find(const Key& key);
+        static void Insert(const Key& key, std::shared_ptr<Program> program);
+        static xword Workers();
+        static bool Receive(int socket, void* data, xword size);
+        static bool Send(int socket, const void* data, xword size);
+        static void Write(const char* data, xword size, void* context);
+        static void Serve(int connection);
+
+    /// @defgroup Public Static Methods
+    public:
+        static void Run();
+        static void Call();
+};
+
+
+/// @ingroup Static Fields
+/// @{
+inline std::mutex Server::mutex;
+inline std::list<Server::Entry> Server::entries;
+inline std::unordered_map<Server::Key, std::list<Server::Entry>::iterator, Server::KeyHash> Server::programs;
+/// @}
+
+/// @ingroup Private Static Methods
+/// @{
+
+// Returns the cached program with the given key (null if there is none),
+// marking it as the most recently used
+std::shared_ptr<Program> Server::Find(const Key& key)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto program = programs.find(key);
+
+    if (program == programs.end())
+        return nullptr;
+    entries.splice(entries.begin(), entries, program->second);
+    return program->second->second;
+}
+
+// Caches a program, evicting the least recently used one if the cache is full
+// (the evicted programs are freed after their last run)
+void Server::Insert(const Key& key, std::shared_ptr<Program> program)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (programs.count(key))
+        return;
+    if (entries.size() == std::max<xword>(GLYPHO_SERVER_CACHE, 1))
+    {
+        programs.erase(entries.back().first);
+        entries.pop_back();
+    }
+    entries.emplace_front(key, std::move(program));
+    programs[key] = entries.begin();
+}
+
+INLINE xword Server::Workers()
+{
+    xword workers = std::thread::hardware_concurrency();
+
+    if (const char* value = getenv("GLYPHO_SERVER_WORKERS"))
+        workers = std::strtoull(value, nullptr, 10);
+    return std::max<xword>(1, workers);
+}
+
+// Receives exactly size bytes; returns false if the peer has closed or failed
+bool Server::Receive(int socket, void* data, xword size)
+{
+#if defined(__unix__)
+    for (char* bytes = (char*) data; size; )
+    {
+        ssize_t count = recv(socket, bytes, size, 0);
+
+        if (count <= 0 && !(count < 0 && errno == EINTR))
+            return false;
+        if (count > 0)
+        {
+            bytes += count;
+            size -= count;
+        }
+    }
+#endif
+    return true;
+}
+
+// Sends exactly size bytes; returns false if the peer has closed or failed
+bool Server::Send(int socket, const void* data, xword size)
+{
+#if defined(__unix__)
+    for (const char* bytes = (const char*) data; size; )
+    {
+        ssize_t count = send(socket, bytes, size, MSG_NOSIGNAL);
+
+        if (count < 0 && errno != EINTR)
+            return false;
+        if (count > 0)
+        {
+            bytes += count;
+            size -= count;
+        }
+    }
+#endif
+    return true;
+}
+
+// The output sink of the runs, sending the blocks to the client; the run of a
+// client that has left is ended (the output left when it ends is dropped)
+void Server::Write(const char* data, xword size, void* context)
+{
+    Stream& stream = *(Stream*) context;
+
+    if (stream.closed)
+        return;
+    if (!Send(stream.socket, &size, sizeof(size)) || !Send(stream.socket, data, size))
+    {
+        stream.closed = true;
+        throw Environment::Exit { -100, 0 };
+    }
+}
+
+// Serves a request on a connection
+void Server::Serve(int connection)
+{
+    Request request;
+    Reply reply { 0, 0 };
+    Stream stream { connection, false };
+    xword end = 0;
+
+    if (!Receive(connection, &request, sizeof(request)) || request.base < 2 || request.base > 37)
+        return;
+
+    Key key { request.checksum, request.sourceSize, request.shorthand != 0 };
+    std::shared_ptr<Program> program = Find(key);
+    byte cached = program != nullptr;
+
+    if (!Send(connection, &cached, sizeof(cached)))
+        return;
+
+    // A missing program is compiled from its source (the parse errors being
+    // replied instead of running it)
+    Environment::Contain(nullptr, request.base);
+    if (!cached)
+    {
+        std::string source(request.sourceSize, '\0');
+
+        if (!Receive(connection, source.data(), source.size()))
+            return;
+        if (Bytecode::Checksum(source.data(), source.size()) != request.checksum)
+            reply.status = -100;
+        else
+            try
+            {
+                program = std::make_shared<Program>(key.shorthand ? Parser::ParseShorthand(source.data(), source.size())
+                                                                   : Parser::ParseSymbols(source.data(), source.size()));
+                Insert(key, program);
+            }
+            catch (const Environment::Exit& exit)
+            {
+                reply = { exit.status, exit.index };
+            }
+            catch (...)
+            {
+                reply.status = -100;
+            }
+    }
+
+    std::string input(request.inputSize, '\0');
+    if (!Receive(connection, input.data(), input.size()))
+        return;
+
+    if (program)
+    {
+        Input::Open(input.data(), input.size());
+        Output::Open(Write, &stream);
+        try
+        {
+            program->Run();
+        }
+        catch (const Environment::Exit& exit)
+        {
+            reply = { exit.status, exit.index };
+        }
+        Memory::Clear();
+        Output::Open(nullptr);
+        Input::Open(0);
+    }
+
+    if (!stream.closed && Send(connection, &end, sizeof(end)))
+        Send(connection, &reply, sizeof(reply));
+}
+
+/// @}
+
+/// @ingroup Public Static Methods
+/// @{
+
+/**
+ * @brief Serves the requests on the socket given to the interpreter (its
+ *      path replacing the program file) until the process is stopped
+ */
+void Server::Run()
+{
+#if defined(__unix__)
+    const char* path = Environment::ProgramFilename();
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un address {};
+    struct stat status;
+    std::vector<std::thread> workers;
+
+    // Only a stale socket is replaced, never another file
+    address.sun_family = AF_UNIX;
+    if (listener < 0 || strlen(path) >= sizeof(address.sun_path) ||
+        (!lstat(path, &status) && !S_ISSOCK(status.st_mode)))
+    {
+        std::cerr << "Invalid socket." << std::endl;
+        exit(-100);
+    }
+    strcpy(address.sun_path, path);
+    unlink(path);
+    if (bind(listener, (sockaddr*) &address, sizeof(address)) || listen(listener, SOMAXCONN))
+    {
+        std::cerr << "Invalid socket." << std::endl;
+        exit(-100);
+    }
+
+    for (xword count = Workers(); workers.size() < count; )
+        workers.emplace_back([listener] {
+            for (;;)
+            {
+                int connection = accept(listener, nullptr, nullptr);
+
+                if (connection < 0)
+                {
+                    if (errno == EINTR || errno == ECONNABORTED)
+                        continue;
+                    return;
+                }
+                try
+                {
+                    Serve(connection);
+                }
+                catch (const std::bad_alloc&)
+                {
+                    // A request too large for the memory is dropped
+                }
+                close(connection);
+            }
+        });
+    for (std::thread& worker : workers)
+        worker.join();
+#else
+    std::cerr << "Invalid socket." << std::endl;
+    exit(-100);
+#endif
+}
+
+/**
+ * @brief Runs the program given to the client on the server, as if run by
+ *      the interpreter: the input is read whole before the run, the output
+ *      is written as it is streamed back and the client exits as the
+ *      interpreter would
+ */
+void Server::Call()
+{
+#if defined(__unix__)
+    const char* path = getenv("GLYPHO_SOCKET") ? getenv("GLYPHO_SOCKET") : socketPath;
+    int connection = socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un address {};
+    std::string input;
+    char block[GLYPHO_INPUT_CAPACITY];
+    Reply reply;
+    byte cached;
+
+    address.sun_family = AF_UNIX;
+    if (connection < 0 || strlen(path) >= sizeof(address.sun_path) ||
+        (strcpy(address.sun_path, path), connect(connection, (sockaddr*) &address, sizeof(address))))
+    {
+        std::cerr << "Invalid socket." << std::endl;
+        exit(-100);
+    }
+
+    for (ssize_t count; (count = read(STDIN_FILENO, block, sizeof(block))) != 0; )
+        if (count > 0)
+            input.append(block, count);
+        else if (errno != EINTR)
+            break;
+
+    bool sent = Parser::WithSource([&] (const char* source, xword size) {
+        Request request { Bytecode::Checksum(source, size), size, Parser::IsShorthand(),
+                          Environment::Base(), input.size() };
+
+        return Send(connection, &request, sizeof(request)) && Receive(connection, &cached, sizeof(cached)) &&
+               (cached || Send(connection, source, size)) && Send(connection, input.data(), input.size());
+    });
+
+    // The output blocks, until the empty one
+    for (xword size; sent && (sent = Receive(connection, &size, sizeof(size))) && size; )
+        for (xword count; size && (sent = Receive(connection, block, count = std::min(size, sizeof(block)))); size -= count)
+            fwrite(block, 1, count, stdout);
+
+    if (!sent || !Receive(connection, &reply, sizeof(reply)))
+    {
+        std::cerr << "Invalid socket." << std::endl;
+        exit(-100);
+    }
+    close(connection);
+
+    if (reply.status == 0)
+        Environment::ExitNormal();
+    else if (reply.status == -1)
+        Environment::ExitError(reply.index);
+    else if (reply.status == -2)
+        Environment::ExitException(reply.index);
+    std::cerr << "Invalid request." << std::endl;
+    exit(-100);
+#else
+    std::cerr << "Invalid socket." << std::endl;
+    exit(-100);
+#endif
+}
+
+/// @}
+
+#endif  // SERVER_HPP
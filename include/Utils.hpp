@@ -19,7 +19,7 @@ namespace Utils
     {
         return base > 10 ?
             (digit < '0' || digit > '9' && (digit < 'A' || digit > ('A' + base - 11))) :
-            (digit < '0' || digit > '9');
+            (digit < '0' || digit > ('0' + base - 1));
     }
     
     INLINE byte ToNumber(char digit)
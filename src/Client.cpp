@@ -0,0 +1,13 @@
+/// ============================
+/// @author Andrei Biu - Pislaru
+/// @brief Entry point of the client of the interpreter server
+/// ============================
+
+#include "../include/Environment.hpp"
+#include "../include/Server.hpp"
+
+int main(int argCount, char** argValues)
+{
+    Environment::Initialize(argCount, argValues);
+    Server::Call();
+}
@@ -3,12 +3,23 @@
 /// @brief Entry point of the program
 /// ============================
 
+#include "../include/Batch.hpp"
+#include "../include/Bytecode.hpp"
 #include "../include/Environment.hpp"
 #include "../include/Parser.hpp"
 #include "../include/Program.hpp"
+#include "../include/Server.hpp"
 
 int main(int argCount, char** argValues)
 {
     Environment::Initialize(argCount, argValues);
-    Program(Parser::Parse()).Run();
+    if (Environment::Batched())
+        Batch::Run();
+    else if (Environment::Serving())
+        Server::Run();
+    else if (Environment::Cache())
+        Bytecode::Load().Run();
+    else
+        Program(Parser::Parse()).Run();
+    Environment::ExitNormal();
 }
@@ -0,0 +1,105 @@
+/// ============================
+/// @author Andrei Biu - Pislaru
+/// @brief Implementation of the embedding interface (libglypho)
+/// ============================
+
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "../include/Glypho.h"
+#include "../include/Environment.hpp"
+#include "../include/Input.hpp"
+#include "../include/Memory.hpp"
+#include "../include/Output.hpp"
+#include "../include/Parser.hpp"
+#include "../include/Program.hpp"
+
+// The runs of a program only read it (the reference mode, the one changing
+// it, is never enabled in the library)
+struct glypho_program
+{
+    mutable Program program;
+};
+
+// Frees the buffers of a thread that has run programs when it exits
+struct Buffers
+{
+    ~Buffers()
+    {
+        Memory::Release();
+        Output::Release();
+        Integer::ReleaseScratch();
+    }
+};
+
+// The sink of the runs without an output
+static void Discard(const char*, xword, void*) {}
+
+int glypho_parse(const char* source, size_t size, int shorthand, glypho_program** program, size_t* index)
+{
+    static std::once_flag tuned;
+
+    if (!program || (!source && size))
+        return GLYPHO_INVALID;
+    *program = nullptr;
+
+    std::call_once(tuned, Environment::Tune);
+    Environment::Contain(nullptr, 10);
+    try
+    {
+        std::vector<Instruction> instructions = shorthand ? Parser::ParseShorthand(source, size)
+                                                          : Parser::ParseSymbols(source, size);
+
+        *program = new glypho_program { Program(std::move(instructions)) };
+        return GLYPHO_OK;
+    }
+    catch (const Environment::Exit& exit)
+    {
+        if (index)
+            *index = exit.index;
+        return exit.status;
+    }
+    catch (...)
+    {
+        return GLYPHO_INVALID;
+    }
+}
+
+int glypho_run(const glypho_program* program, const char* input, size_t inputSize,
+               unsigned base, glypho_write write, void* context, size_t* index)
+{
+    thread_local Buffers buffers;
+    int status = GLYPHO_OK;
+
+    if (!program || (!input && inputSize) || base < 2 || base > 37)
+        return GLYPHO_INVALID;
+
+    Environment::Contain(nullptr, base);
+    Input::Open(input, inputSize);
+    Output::Open(write ? write : Discard, context);
+    try
+    {
+        program->program.Run();
+    }
+    catch (const Environment::Exit& exit)
+    {
+        status = exit.status;
+        if (index)
+            *index = exit.index;
+    }
+    catch (...)
+    {
+        status = GLYPHO_INVALID;
+    }
+    Memory::Clear();
+    Output::Open(nullptr);
+    Input::Open(0);
+
+    return status;
+}
+
+void glypho_free(glypho_program* program)
+{
+    delete program;
+}
@@ -0,0 +1,150 @@
+/// ============================
+/// @author Andrei Biu - Pislaru
+/// @brief Tests of the embedding interface (libglypho), through its C ABI
+/// ============================
+
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "../include/Glypho.h"
+
+#define THREAD_RUNS 200
+
+// The output of a run, gathered by the write callback
+struct Output
+{
+    char data[256];
+    size_t size;
+};
+
+// The run of a thread on the shared program
+struct Job
+{
+    const glypho_program* program;
+    const char* input;
+    const char* expected;
+    int failed;
+};
+
+static int failures = 0;
+
+static void Append(const char* data, size_t size, void* context)
+{
+    struct Output* output = (struct Output*) context;
+
+    if (output->size + size > sizeof(output->data))
+        size = sizeof(output->data) - output->size;
+    memcpy(output->data + output->size, data, size);
+    output->size += size;
+}
+
+static void Check(int passed, const char* name)
+{
+    if (passed)
+        printf("\033[32mPASSED\033[0m Test \033[1;33m%s\033[0m\n", name);
+    else
+    {
+        printf("\033[31mFAILED\033[0m Test \033[1;33m%s\033[0m\n", name);
+        ++failures;
+    }
+}
+
+static int Matches(const struct Output* output, const char* expected)
+{
+    return output->size == strlen(expected) && !memcmp(output->data, expected, output->size);
+}
+
+// Parses a shorthand program, returning null on failure
+static glypho_program* Parse(const char* source)
+{
+    glypho_program* program = NULL;
+    size_t index = 0;
+
+    return glypho_parse(source, strlen(source), 1, &program, &index) == GLYPHO_OK ? program : NULL;
+}
+
+static void* Run(void* context)
+{
+    struct Job* job = (struct Job*) context;
+
+    for (int run = 0; run < THREAD_RUNS && !job->failed; ++run)
+    {
+        struct Output output = { { 0 }, 0 };
+        size_t index = 0;
+
+        job->failed = glypho_run(job->program, job->input, strlen(job->input), 10, Append, &output, &index) != GLYPHO_OK ||
+                      !Matches(&output, job->expected);
+    }
+    return NULL;
+}
+
+// An unbalanced brace is a parse error at its index
+static void TestParseError(void)
+{
+    const char source[] = "11+[o";
+    glypho_program* program = NULL;
+    size_t index = 0;
+    int status = glypho_parse(source, strlen(source), 1, &program, &index);
+
+    Check(status == GLYPHO_ERROR && index == 5 && !program, "library-parse-error");
+}
+
+// A pop on an empty memory is an exception at its index
+static void TestException(void)
+{
+    glypho_program* program = Parse("1!!");
+    struct Output output = { { 0 }, 0 };
+    size_t index = 0;
+    int status = program ? glypho_run(program, NULL, 0, 10, Append, &output, &index) : GLYPHO_INVALID;
+
+    Check(status == GLYPHO_EXCEPTION && index == 2, "library-exception");
+    glypho_free(program);
+}
+
+// The numbers read from the input are written to the callback, in the base
+static void TestOutput(void)
+{
+    glypho_program* program = Parse("id*o1o");
+    struct Output decimal = { { 0 }, 0 }, hexadecimal = { { 0 }, 0 };
+    size_t index = 0;
+    int passed = program &&
+                 glypho_run(program, "12\n", 3, 10, Append, &decimal, &index) == GLYPHO_OK &&
+                 glypho_run(program, "FF\n", 3, 16, Append, &hexadecimal, &index) == GLYPHO_OK;
+
+    Check(passed && Matches(&decimal, "144\n1\n") && Matches(&hexadecimal, "FE01\n1\n"),
+          "library-output");
+    glypho_free(program);
+}
+
+// Two threads run the same program at once, each on its own input
+static void TestThreads(void)
+{
+    glypho_program* program = Parse("idd**o");
+    struct Job jobs[] = {
+        { program, "12\n", "1728\n", 0 },
+        { program, "123456789\n", "1881676371789154860897069\n", 0 },
+    };
+    pthread_t threads[2];
+
+    if (program)
+    {
+        for (int thread = 0; thread < 2; ++thread)
+            pthread_create(&threads[thread], NULL, Run, &jobs[thread]);
+        for (int thread = 0; thread < 2; ++thread)
+            pthread_join(threads[thread], NULL);
+    }
+
+    Check(program && !jobs[0].failed && !jobs[1].failed, "library-threads");
+    glypho_free(program);
+}
+
+int main(void)
+{
+    TestParseError();
+    TestException();
+    TestOutput();
+    TestThreads();
+
+    return failures != 0;
+}
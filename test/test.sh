@@ -1,63 +1,201 @@
 #!/bin/bash
 
-TEST_SUITES=${@:-test bigtest extra bigextra error exception exceptionextra anybase biganybase exceptionanybase}
+TEST_SUITES=${@:-test bigtest extra bigextra error exception exceptionextra anybase biganybase exceptionanybase shorthand}
 TEST_DIR=`dirname $0`
 IN_DIR="$TEST_DIR/in"
 OUT_DIR="$TEST_DIR/out"
 REF_DIR="$TEST_DIR/ref"
 LOG_DIR="$TEST_DIR/log"
 
-run_tests () {
+# Prints the sources of the tests of the selected suites
+find_tests () {
     for TEST_SUITE in ${TEST_SUITES}; do
-        for SRC_FILE in `find ${IN_DIR} -iname "${TEST_SUITE}[0-9]*.gly"`; do
-            TEST_NAME=`basename ${SRC_FILE/.gly/}`
-            IN_FILE="$IN_DIR/$TEST_NAME.in"
-            OUT_REF_FILE="$OUT_DIR/$TEST_NAME.out"
-            ERR_REF_FILE="$OUT_DIR/$TEST_NAME.err"
-            RETVAL_REF=`cat "$OUT_DIR/$TEST_NAME.ret"`
-
-            RAW_OUT_FILE="$OUT_DIR/$TEST_NAME.rawout"
-            OUT_FILE="$OUT_DIR/$TEST_NAME.out"
-            RAW_ERR_FILE="$OUT_DIR/$TEST_NAME.rawerr"
-            ERR_FILE="$OUT_DIR/$TEST_NAME.err"
-            RET_FILE="$OUT_DIR/$TEST_NAME.ret"
-
-            LOG_COM_FILE="$LOG_DIR/$TEST_NAME.command"
-
-            rm ${RAW_OUT_FILE} ${RAW_ERR_FILE} ${OUT_FILE} ${ERR_FILE} ${LOG_COM_FILE} &> /dev/null
-
-            unset BASE
-            if [[ $TEST_NAME =~ .*anybase.* ]]; then
-                BASE=`grep ^${TEST_NAME} ${IN_DIR}/base.cfg | cut -d ' ' -f 2`
-            fi
+        # The shorthand tests are run from their .gsh / .glh sources
+        SRC_PATTERN="${TEST_SUITE}[0-9]*.gly"
+        if [ "${TEST_SUITE}" = "shorthand" ]; then
+            SRC_PATTERN="${TEST_SUITE}[0-9]*.g[sl]h"
+        fi
 
-            make -s run source=${SRC_FILE} base=${BASE} < ${IN_FILE} > ${RAW_OUT_FILE} 2> ${RAW_ERR_FILE}
+        find ${IN_DIR} -iname "${SRC_PATTERN}"
+    done
+}
 
-            cat ${RAW_OUT_FILE} | grep -vi Makefile > "$OUT_FILE"
-            diff -bBq "${OUT_FILE}" "${OUT_REF_FILE}" &> /dev/null
-            OUT_CMP=$?
+# Prints the base of a test (empty for the decimal ones)
+find_base () {
+    if [[ $1 =~ .*anybase.* ]]; then
+        grep ^$1 ${IN_DIR}/base.cfg | cut -d ' ' -f 2
+    fi
+}
+
+run_tests () {
+    for SRC_FILE in `find_tests`; do
+        TEST_NAME=`basename ${SRC_FILE%.*}`
+        IN_FILE="$IN_DIR/$TEST_NAME.in"
+        OUT_REF_FILE="$REF_DIR/$TEST_NAME.out"
+        ERR_REF_FILE="$REF_DIR/$TEST_NAME.err"
+        RETVAL_REF=`cat "$REF_DIR/$TEST_NAME.ret"`
+
+        RAW_OUT_FILE="$OUT_DIR/$TEST_NAME.rawout"
+        OUT_FILE="$OUT_DIR/$TEST_NAME.out"
+        RAW_ERR_FILE="$OUT_DIR/$TEST_NAME.rawerr"
+        ERR_FILE="$OUT_DIR/$TEST_NAME.err"
+        RET_FILE="$OUT_DIR/$TEST_NAME.ret"
+
+        LOG_COM_FILE="$LOG_DIR/$TEST_NAME.command"
+
+        rm ${RAW_OUT_FILE} ${RAW_ERR_FILE} ${OUT_FILE} ${ERR_FILE} ${LOG_COM_FILE} &> /dev/null
+
+        BASE=`find_base ${TEST_NAME}`
+
+        make -s run source=${SRC_FILE} base=${BASE} options="${OPTIONS}" < ${IN_FILE} > ${RAW_OUT_FILE} 2> ${RAW_ERR_FILE}
+
+        cat ${RAW_OUT_FILE} | grep -vi Makefile > "$OUT_FILE"
+        diff -bBq "${OUT_FILE}" "${OUT_REF_FILE}" &> /dev/null
+        OUT_CMP=$?
+
+        MAKE_ERR_LINE=`cat ${RAW_ERR_FILE} | sed 's/make.* /\nmake: /' | grep ^make`
+        RETVAL="${MAKE_ERR_LINE##* }"
+        RETVAL="${RETVAL:-0}"
+
+        cat ${RAW_ERR_FILE} | sed 's/make.* /\nmake: /' | grep -v ^make > ${ERR_FILE}
+        diff -bBq "${ERR_FILE}" "${ERR_REF_FILE}" &> /dev/null
+        ERR_CMP=$?
+
+        if [ "$OUT_CMP" = "0" ] && [ "$ERR_CMP" = "0" ] && [ "$RETVAL" = "$RETVAL_REF" ]; then
+            echo -e "\e[32mPASSED\e[0m Test \e[1;33m${TEST_NAME}\e[0m"
+            rm ${RAW_OUT_FILE} ${OUT_FILE} ${ERR_FILE} ${RAW_ERR_FILE} 2>/dev/null
+        else
+            echo -e "\e[31mFAILED\e[0m Test $\e[1;33m${TEST_NAME}\e[0m"
+            echo ${RETVAL} > ${RET_FILE}
+            echo "make -s run input=${SRC_FILE} base=$BASE < ${IN_FILE} > ${RAW_OUT_FILE} 2> ${RAW_ERR_FILE}" > ${LOG_COM_FILE}
+            echo "Output comparison: ${OUT_CMP}, expected 0"
+            echo "Error comparison: ${ERR_CMP}, expected 0"
+            echo "Return value comparison: ${RETVAL}, expected ${RETVAL_REF}"
+        fi
+    done
+}
+
+# Runs all the tests as the jobs of a single batch (--batch), comparing the
+# output files and the report lines (exit status & message) with the references
+run_batch () {
+    JOBS_FILE="$OUT_DIR/batch.jobs"
+    REPORT_FILE="$OUT_DIR/batch.report"
+
+    rm -f ${JOBS_FILE} ${REPORT_FILE}
+    for SRC_FILE in `find_tests`; do
+        TEST_NAME=`basename ${SRC_FILE%.*}`
+        echo "${SRC_FILE} $IN_DIR/$TEST_NAME.in $OUT_DIR/$TEST_NAME.batch.out `find_base ${TEST_NAME}`" >> ${JOBS_FILE}
+    done
 
-            MAKE_ERR_LINE=`cat ${RAW_ERR_FILE} | sed 's/make.* /\nmake: /' | grep ^make`
-            RETVAL="${MAKE_ERR_LINE##* }"
-            RETVAL="${RETVAL:-0}"
+    make -s run source=${JOBS_FILE} options="--batch ${OPTIONS}" > ${REPORT_FILE}
 
-            cat ${RAW_ERR_FILE} | sed 's/make.* /\nmake: /' | grep -v ^make > ${ERR_FILE}
-            diff -bBq "${ERR_FILE}" "${ERR_REF_FILE}" &> /dev/null
+    while read -r SRC_FILE RETVAL MESSAGE; do
+        TEST_NAME=`basename ${SRC_FILE%.*}`
+        OUT_FILE="$OUT_DIR/$TEST_NAME.batch.out"
+        RETVAL_REF=`cat "$REF_DIR/$TEST_NAME.ret"`
+        MESSAGE_REF=`cat "$REF_DIR/$TEST_NAME.err"`
+
+        diff -bBq "${OUT_FILE}" "$REF_DIR/$TEST_NAME.out" &> /dev/null
+        OUT_CMP=$?
+
+        if [ "$OUT_CMP" = "0" ] && [ "$MESSAGE" = "$MESSAGE_REF" ] && [ "$RETVAL" = "$RETVAL_REF" ]; then
+            echo -e "\e[32mPASSED\e[0m Batch test \e[1;33m${TEST_NAME}\e[0m"
+            rm ${OUT_FILE} 2>/dev/null
+        else
+            echo -e "\e[31mFAILED\e[0m Batch test \e[1;33m${TEST_NAME}\e[0m"
+            echo "Output comparison: ${OUT_CMP}, expected 0"
+            echo "Error comparison: ${MESSAGE}, expected ${MESSAGE_REF}"
+            echo "Return value comparison: ${RETVAL}, expected ${RETVAL_REF}"
+        fi
+    done < ${REPORT_FILE}
+    rm -f ${JOBS_FILE} ${REPORT_FILE}
+}
+
+# Runs all the tests from their bytecode caches (--cache) after damaging a byte of
+# each (the middle one of the compiled program), which must be rebuilt instead
+run_cache () {
+    for SRC_FILE in `find_tests`; do
+        TEST_NAME=`basename ${SRC_FILE%.*}`
+        CACHE_FILE="${SRC_FILE}.glc"
+        IN_FILE="$IN_DIR/$TEST_NAME.in"
+        OUT_FILE="$OUT_DIR/$TEST_NAME.cache.out"
+        ERR_FILE="$OUT_DIR/$TEST_NAME.cache.err"
+        RETVAL_REF=`cat "$REF_DIR/$TEST_NAME.ret"`
+        BASE=`find_base ${TEST_NAME}`
+
+        rm -f ${CACHE_FILE}
+        ./glypho-interpreter ${SRC_FILE} ${BASE} --cache ${OPTIONS} < ${IN_FILE} &> /dev/null
+        if [ -f ${CACHE_FILE} ]; then
+            POSITION=$(( (72 + `stat -c %s ${CACHE_FILE}`) / 2 ))
+            VALUE=`od -An -tu1 -j ${POSITION} -N1 ${CACHE_FILE}`
+            printf "\\$(printf '%03o' $(( VALUE ^ 0x5A )))" | dd of=${CACHE_FILE} bs=1 seek=${POSITION} conv=notrunc &> /dev/null
+        fi
+
+        ./glypho-interpreter ${SRC_FILE} ${BASE} --cache ${OPTIONS} < ${IN_FILE} > ${OUT_FILE} 2> ${ERR_FILE}
+        RETVAL=$?
+        rm -f ${CACHE_FILE}
+
+        diff -bBq "${OUT_FILE}" "$REF_DIR/$TEST_NAME.out" &> /dev/null
+        OUT_CMP=$?
+        diff -bBq "${ERR_FILE}" "$REF_DIR/$TEST_NAME.err" &> /dev/null
+        ERR_CMP=$?
+
+        if [ "$OUT_CMP" = "0" ] && [ "$ERR_CMP" = "0" ] && [ "$RETVAL" = "$RETVAL_REF" ]; then
+            echo -e "\e[32mPASSED\e[0m Cache test \e[1;33m${TEST_NAME}\e[0m"
+            rm ${OUT_FILE} ${ERR_FILE} 2>/dev/null
+        else
+            echo -e "\e[31mFAILED\e[0m Cache test \e[1;33m${TEST_NAME}\e[0m"
+            echo "Output comparison: ${OUT_CMP}, expected 0"
+            echo "Error comparison: ${ERR_CMP}, expected 0"
+            echo "Return value comparison: ${RETVAL}, expected ${RETVAL_REF}"
+        fi
+    done
+}
+
+# Runs all the tests through the client on a server started for them (--serve),
+# each one twice in a row: compiling its program (cold) and then taking it from
+# the cache of the server (warm)
+run_client () {
+    SOCKET=`mktemp -u /tmp/glypho-test.XXXXXX.sock`
+
+    make -s client
+    ./glypho-interpreter ${SOCKET} --serve ${OPTIONS} &
+    SERVER=$!
+    while [ ! -S ${SOCKET} ] && kill -0 ${SERVER} 2> /dev/null; do
+        sleep 0.1
+    done
+
+    for SRC_FILE in `find_tests`; do
+        for PASS in cold warm; do
+            TEST_NAME=`basename ${SRC_FILE%.*}`
+            OUT_FILE="$OUT_DIR/$TEST_NAME.client.out"
+            ERR_FILE="$OUT_DIR/$TEST_NAME.client.err"
+            RETVAL_REF=`cat "$REF_DIR/$TEST_NAME.ret"`
+
+            GLYPHO_SOCKET=${SOCKET} ./glypho-client ${SRC_FILE} `find_base ${TEST_NAME}` \
+                < "$IN_DIR/$TEST_NAME.in" > ${OUT_FILE} 2> ${ERR_FILE}
+            RETVAL=$?
+
+            diff -bBq "${OUT_FILE}" "$REF_DIR/$TEST_NAME.out" &> /dev/null
+            OUT_CMP=$?
+            diff -bBq "${ERR_FILE}" "$REF_DIR/$TEST_NAME.err" &> /dev/null
             ERR_CMP=$?
 
             if [ "$OUT_CMP" = "0" ] && [ "$ERR_CMP" = "0" ] && [ "$RETVAL" = "$RETVAL_REF" ]; then
-                echo -e "\e[32mPASSED\e[0m Test \e[1;33m${TEST_NAME}\e[0m"
-                rm ${RAW_OUT_FILE} ${OUT_FILE} ${ERR_FILE} ${RAW_ERR_FILE} 2>/dev/null
+                echo -e "\e[32mPASSED\e[0m Client test (${PASS}) \e[1;33m${TEST_NAME}\e[0m"
+                rm ${OUT_FILE} ${ERR_FILE} 2>/dev/null
             else
-                echo -e "\e[31mFAILED\e[0m Test $\e[1;33m${TEST_NAME}\e[0m"
-                echo ${RETVAL} > ${RET_FILE}
-                echo "make -s run input=${SRC_FILE} base=$BASE < ${IN_FILE} > ${RAW_OUT_FILE} 2> ${RAW_ERR_FILE}" > ${LOG_COM_FILE}
+                echo -e "\e[31mFAILED\e[0m Client test (${PASS}) \e[1;33m${TEST_NAME}\e[0m"
                 echo "Output comparison: ${OUT_CMP}, expected 0"
                 echo "Error comparison: ${ERR_CMP}, expected 0"
                 echo "Return value comparison: ${RETVAL}, expected ${RETVAL_REF}"
             fi
         done
     done
+
+    kill ${SERVER}
+    wait ${SERVER} 2> /dev/null
+    rm -f ${SOCKET}
 }
 
 
@@ -70,5 +208,14 @@ rm -f ${LOG_DIR}/*
 echo "Runing tests..."
 run_tests
 
+echo "Runing batch tests..."
+run_batch
+
+echo "Runing cache tests..."
+run_cache
+
+echo "Runing client tests..."
+run_client
+
 echo "Finishing..."
 make clean